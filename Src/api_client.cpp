@@ -12,20 +12,29 @@ static size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* use
     return size * nmemb;
 }
 
+// Progress callback - returning non-zero makes curl abandon the transfer
+// curl calls this at least once a second, even while it's waiting to connect
+static int AbortCallback(void* clientp, curl_off_t, curl_off_t, curl_off_t, curl_off_t) {
+    const std::atomic<bool>* abort = static_cast<const std::atomic<bool>*>(clientp);
+    return abort->load() ? 1 : 0;
+}
+
 TrainAPIClient::TrainAPIClient(const std::string& api_url, const std::string& api_key, bool use_rdm) {
     base_url = api_url;
     base_url_key = api_key;
     rail_data_marketplace = use_rdm;
+    timeout_seconds = 30;
 }
 
-std::string TrainAPIClient::fetchDepartures(const std::string& from, const std::string& to) const {
+std::string TrainAPIClient::fetchDepartures(const std::string& from, const std::string& to,
+                                            const std::atomic<bool>* abort) const {
     CURL* curl = curl_easy_init();
     struct curl_slist *headers = NULL;
     std::string readBuffer;
     std::string api_header;
     std::string url;
-    FILE* curl_log_file;
-    FILE* curl_json_file;
+    FILE* curl_log_file = NULL;
+    FILE* curl_json_file = NULL;
     
     if(!curl) {
         throw std::runtime_error("Failed to initialize CURL");
@@ -66,6 +75,14 @@ std::string TrainAPIClient::fetchDepartures(const std::string& from, const std::
     curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, timeout_seconds);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);   // Called from a worker thread - don't use signals for timeouts
+    
+    if(abort) {
+        curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, AbortCallback);
+        curl_easy_setopt(curl, CURLOPT_XFERINFODATA, const_cast<std::atomic<bool>*>(abort));
+        curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+    }
 
     if(debug_mode) {
        // Enable verbose curl logging
@@ -105,11 +122,12 @@ std::string TrainAPIClient::fetchDepartures(const std::string& from, const std::
            }
         }
 
-        fflush(curl_log_file);
-        fflush(curl_json_file);
-
-        fclose(curl_log_file);
-        fclose(curl_json_file);
+        if(curl_log_file) {
+            fclose(curl_log_file);
+        }
+        if(curl_json_file) {
+            fclose(curl_json_file);
+        }
     }
  
     if(res != CURLE_OK) {
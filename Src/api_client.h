@@ -8,6 +8,7 @@
 #define API_CLIENT_H
 
 #include <curl/curl.h>
+#include <atomic>
 #include <string>
 #include <stdexcept>
 #include <iostream>
@@ -16,19 +17,32 @@
 extern bool debug_mode;
 #define DEBUG_PRINT(x) if(debug_mode) { std::cerr << x << std::endl; }
 
-// Forward declaration of the callback function
-static size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* userp);
-
 class TrainAPIClient {
 private:
     std::string base_url;
     std::string base_url_key;
     bool rail_data_marketplace;
+    long timeout_seconds;        // Longest an API call may take (0 for no limit)
     
 public:
     TrainAPIClient(const std::string& api_url, const std::string& api_key, bool use_rdm);
     
-    std::string fetchDepartures(const std::string& from, const std::string& to) const;
+    /**
+     * Set the longest an API call may take before it fails
+     * @param seconds Timeout in seconds (0 for no limit)
+     */
+    void setTimeout(long seconds) { timeout_seconds = seconds; }
+    
+    /**
+     * Fetch the departure board
+     * @param from Departure station code
+     * @param to Destination station code (empty for all destinations)
+     * @param abort If set, the call is abandoned (and throws) soon after this becomes true
+     * @return The JSON payload
+     * @throws std::runtime_error if the call fails, times out or is aborted
+     */
+    std::string fetchDepartures(const std::string& from, const std::string& to,
+                                const std::atomic<bool>* abort = nullptr) const;
 };
 
 #endif // API_CLIENT_H
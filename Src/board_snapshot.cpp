@@ -0,0 +1,274 @@
+// Train Display - an RGB matrix departure board for the Raspberry Pi
+// Binary board snapshots
+// Version 1.0
+// Instructions, fixes and issues at https://github.com/jonmorrissmith/RGB_Matrix_Train_Departure_Board
+//
+#include "board_snapshot.h"
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <unordered_map>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace {
+
+// Builds the string pool, storing each distinct string once
+class StringPool {
+public:
+    SnapshotString add(const std::string& str) {
+        auto it = offsets.find(str);
+        if (it != offsets.end()) {
+            return it->second;
+        }
+        SnapshotString ref{static_cast<uint32_t>(pool.size()), static_cast<uint32_t>(str.length())};
+        pool.append(str);
+        offsets.emplace(str, ref);
+        return ref;
+    }
+
+    const std::string& data() const { return pool; }
+
+private:
+    std::string pool;
+    std::unordered_map<std::string, SnapshotString> offsets;
+};
+
+std::string systemError(const std::string& what, const std::string& path) {
+    return what + " " + path + ": " + std::strerror(errno);
+}
+
+} // namespace
+
+void encodeBoardSnapshot(const std::vector<TrainServiceParser::TrainServiceInfo>& services,
+                         const std::string& location_name,
+                         const std::string& nrcc_message,
+                         uint64_t data_version,
+                         size_t dropped_services,
+                         std::vector<char>& image) {
+    StringPool pool;
+    std::vector<SnapshotService> service_records(services.size());
+    std::vector<SnapshotCallingPoint> calling_point_records;
+
+    for (size_t i = 0; i < services.size(); i++) {
+        const auto& service = services[i];
+        SnapshotService& record = service_records[i];
+
+        record.scheduledTime = pool.add(service.scheduledTime);
+        record.estimatedTime = pool.add(service.estimatedTime);
+        record.platform = pool.add(service.platform);
+        record.destination = pool.add(service.destination);
+        record.destinationCRS = pool.add(service.destinationCRS);
+        record.operator_raw = pool.add(service.operator_raw);
+        record.operatorCode = pool.add(service.operatorCode);
+        record.coaches = pool.add(service.coaches);
+        record.cancelReason = pool.add(service.cancelReason);
+        record.delayReason = pool.add(service.delayReason);
+        record.adhocAlerts = pool.add(service.adhocAlerts);
+        record.serviceID = pool.add(service.serviceID);
+        record.isCancelled = service.isCancelled ? 1 : 0;
+        record.isDelayed = service.isDelayed ? 1 : 0;
+        record.reserved[0] = record.reserved[1] = 0;
+
+        record.first_calling_point = static_cast<uint32_t>(calling_point_records.size());
+        record.calling_point_count = static_cast<uint32_t>(service.callingPointList.size());
+        for (const auto& point : service.callingPointList) {
+            SnapshotCallingPoint point_record;
+            point_record.locationName = pool.add(point.locationName);
+            point_record.crs = pool.add(point.crs);
+            point_record.scheduledTime = pool.add(point.scheduledTime);
+            point_record.estimatedTime = pool.add(point.estimatedTime);
+            calling_point_records.push_back(point_record);
+        }
+    }
+
+    SnapshotHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, BOARD_SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = BOARD_SNAPSHOT_VERSION;
+    header.byte_order = BOARD_SNAPSHOT_BYTE_ORDER;
+    header.header_size = sizeof(SnapshotHeader);
+    header.service_record_size = sizeof(SnapshotService);
+    header.calling_point_record_size = sizeof(SnapshotCallingPoint);
+    header.service_count = static_cast<uint32_t>(service_records.size());
+    header.calling_point_count = static_cast<uint32_t>(calling_point_records.size());
+    header.location_name = pool.add(location_name);
+    header.nrcc_message = pool.add(nrcc_message);
+    header.string_pool_size = static_cast<uint32_t>(pool.data().size());
+    header.data_version = data_version;
+    header.created = static_cast<int64_t>(std::time(nullptr));
+    header.dropped_services = static_cast<uint32_t>(dropped_services);
+
+    header.services_offset = sizeof(SnapshotHeader);
+    header.calling_points_offset = header.services_offset + service_records.size() * sizeof(SnapshotService);
+    header.string_pool_offset = header.calling_points_offset + calling_point_records.size() * sizeof(SnapshotCallingPoint);
+    header.file_size = header.string_pool_offset + header.string_pool_size;
+
+    image.resize(header.file_size);
+    std::memcpy(image.data(), &header, sizeof(header));
+    if (!service_records.empty()) {
+        std::memcpy(image.data() + header.services_offset, service_records.data(), service_records.size() * sizeof(SnapshotService));
+    }
+    if (!calling_point_records.empty()) {
+        std::memcpy(image.data() + header.calling_points_offset, calling_point_records.data(), calling_point_records.size() * sizeof(SnapshotCallingPoint));
+    }
+    std::memcpy(image.data() + header.string_pool_offset, pool.data().data(), header.string_pool_size);
+}
+
+void writeBoardSnapshot(const std::string& path, const std::vector<char>& image) {
+    std::string tmp_path = path + ".tmp";
+
+    int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error(systemError("Failed to create snapshot", tmp_path));
+    }
+
+    size_t written = 0;
+    while (written < image.size()) {
+        ssize_t n = ::write(fd, image.data() + written, image.size() - written);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::string error = systemError("Failed to write snapshot", tmp_path);
+            ::close(fd);
+            ::unlink(tmp_path.c_str());
+            throw std::runtime_error(error);
+        }
+        written += static_cast<size_t>(n);
+    }
+
+    if (::fsync(fd) != 0) {
+        std::string error = systemError("Failed to sync snapshot", tmp_path);
+        ::close(fd);
+        ::unlink(tmp_path.c_str());
+        throw std::runtime_error(error);
+    }
+    ::close(fd);
+
+    if (::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::string error = systemError("Failed to replace snapshot", path);
+        ::unlink(tmp_path.c_str());
+        throw std::runtime_error(error);
+    }
+    DEBUG_PRINT("Snapshot written to " << path << " (" << image.size() << " bytes)");
+}
+
+BoardSnapshot::BoardSnapshot(const std::string& path) : base(nullptr), size(0), mapped(false) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error(systemError("Failed to open snapshot", path));
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        std::string error = systemError("Failed to read snapshot", path);
+        ::close(fd);
+        throw std::runtime_error(error);
+    }
+    if (st.st_size < static_cast<off_t>(sizeof(SnapshotHeader))) {
+        ::close(fd);
+        throw std::runtime_error("Snapshot " + path + " is too small to be valid");
+    }
+
+    size = static_cast<size_t>(st.st_size);
+    void* addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);    // The mapping stays valid once the file is closed
+    if (addr == MAP_FAILED) {
+        throw std::runtime_error(systemError("Failed to map snapshot", path));
+    }
+    base = static_cast<const char*>(addr);
+    mapped = true;
+
+    try {
+        validate();
+    } catch (...) {
+        ::munmap(const_cast<char*>(base), size);
+        throw;
+    }
+}
+
+BoardSnapshot::BoardSnapshot(const void* data, size_t length)
+    : base(static_cast<const char*>(data)), size(length), mapped(false) {
+    validate();
+}
+
+BoardSnapshot::~BoardSnapshot() {
+    if (mapped) {
+        ::munmap(const_cast<char*>(base), size);
+    }
+}
+
+// Check everything the accessors rely on - afterwards every record and string is known to be in bounds
+void BoardSnapshot::validate() {
+    if (size < sizeof(SnapshotHeader) || reinterpret_cast<uintptr_t>(base) % alignof(SnapshotHeader) != 0) {
+        throw std::runtime_error("Invalid snapshot: too small or misaligned");
+    }
+    hdr = reinterpret_cast<const SnapshotHeader*>(base);
+
+    if (std::memcmp(hdr->magic, BOARD_SNAPSHOT_MAGIC, sizeof(hdr->magic)) != 0) {
+        throw std::runtime_error("Invalid snapshot: not a board snapshot");
+    }
+    if (hdr->version != BOARD_SNAPSHOT_VERSION) {
+        throw std::runtime_error("Invalid snapshot: version " + std::to_string(hdr->version) +
+                                 " (expected " + std::to_string(BOARD_SNAPSHOT_VERSION) + ")");
+    }
+    if (hdr->byte_order != BOARD_SNAPSHOT_BYTE_ORDER) {
+        throw std::runtime_error("Invalid snapshot: written on a machine with a different byte order");
+    }
+    if (hdr->header_size != sizeof(SnapshotHeader) ||
+        hdr->service_record_size != sizeof(SnapshotService) ||
+        hdr->calling_point_record_size != sizeof(SnapshotCallingPoint)) {
+        throw std::runtime_error("Invalid snapshot: record sizes don't match this build");
+    }
+    if (hdr->file_size != size) {
+        throw std::runtime_error("Invalid snapshot: truncated or has trailing data");
+    }
+
+    // Sections - in order, aligned and inside the file (counts are 32 bit so none of this can overflow)
+    uint64_t services_end = hdr->services_offset + static_cast<uint64_t>(hdr->service_count) * sizeof(SnapshotService);
+    uint64_t calling_points_end = hdr->calling_points_offset + static_cast<uint64_t>(hdr->calling_point_count) * sizeof(SnapshotCallingPoint);
+    if (hdr->services_offset != sizeof(SnapshotHeader) ||
+        hdr->calling_points_offset != services_end ||
+        hdr->string_pool_offset != calling_points_end ||
+        hdr->string_pool_offset + hdr->string_pool_size != size) {
+        throw std::runtime_error("Invalid snapshot: section offsets are inconsistent");
+    }
+    static_assert(sizeof(SnapshotHeader) % alignof(SnapshotService) == 0 &&
+                  sizeof(SnapshotService) % alignof(SnapshotCallingPoint) == 0, "Snapshot sections must stay aligned");
+
+    services = reinterpret_cast<const SnapshotService*>(base + hdr->services_offset);
+    calling_points = reinterpret_cast<const SnapshotCallingPoint*>(base + hdr->calling_points_offset);
+    string_pool = base + hdr->string_pool_offset;
+
+    validateString(hdr->location_name);
+    validateString(hdr->nrcc_message);
+
+    for (size_t i = 0; i < hdr->service_count; i++) {
+        const SnapshotService& record = services[i];
+        const SnapshotString* strings[] = {
+            &record.scheduledTime, &record.estimatedTime, &record.platform, &record.destination,
+            &record.destinationCRS, &record.operator_raw, &record.operatorCode, &record.coaches,
+            &record.cancelReason, &record.delayReason, &record.adhocAlerts, &record.serviceID
+        };
+        for (const SnapshotString* str : strings) {
+            validateString(*str);
+        }
+        if (static_cast<uint64_t>(record.first_calling_point) + record.calling_point_count > hdr->calling_point_count) {
+            throw std::runtime_error("Invalid snapshot: calling points of service " + std::to_string(i) + " out of range");
+        }
+    }
+
+    for (size_t i = 0; i < hdr->calling_point_count; i++) {
+        validateString(calling_points[i].locationName);
+        validateString(calling_points[i].crs);
+        validateString(calling_points[i].scheduledTime);
+        validateString(calling_points[i].estimatedTime);
+    }
+}
+
+void BoardSnapshot::validateString(const SnapshotString& str) const {
+    if (static_cast<uint64_t>(str.offset) + str.length > hdr->string_pool_size) {
+        throw std::runtime_error("Invalid snapshot: string out of range");
+    }
+}
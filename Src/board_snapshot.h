@@ -0,0 +1,172 @@
+// Train Display - an RGB matrix departure board for the Raspberry Pi
+// Binary board snapshots
+// Version 1.0
+// Instructions, fixes and issues at https://github.com/jonmorrissmith/RGB_Matrix_Train_Departure_Board
+//
+// A snapshot is a parsed board - services, calling points and messages - in a fixed binary layout.
+// It can be mapped straight into memory and read in place, with no parse step, so it's used for:
+//   - a warm start when the first API call fails (set 'snapshot_path=' in config.txt)
+//   - handing a board from one process to another
+//   - recording boards to replay later
+//
+// File layout (native byte order - the header records it and a mismatched file is rejected):
+//   SnapshotHeader
+//   SnapshotService[service_count]
+//   SnapshotCallingPoint[calling_point_count]      - each service refers to a contiguous range
+//   string pool[string_pool_size]                  - every string is an (offset, length) into this
+//
+// Bump BOARD_SNAPSHOT_VERSION whenever a record changes - older files are then rejected rather than misread.
+//
+#ifndef BOARD_SNAPSHOT_H
+#define BOARD_SNAPSHOT_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include "train_service_parser.h"
+
+static const char BOARD_SNAPSHOT_MAGIC[8] = {'T', 'D', 'B', 'O', 'A', 'R', 'D', '\0'};
+static const uint32_t BOARD_SNAPSHOT_VERSION = 2;
+static const uint32_t BOARD_SNAPSHOT_BYTE_ORDER = 0x01020304;
+
+struct SnapshotString {                     // A string in the pool
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct SnapshotHeader {
+    char magic[8];                          // BOARD_SNAPSHOT_MAGIC
+    uint32_t version;                       // BOARD_SNAPSHOT_VERSION
+    uint32_t byte_order;                    // BOARD_SNAPSHOT_BYTE_ORDER as written
+    uint32_t header_size;                   // Record sizes - a cheap check the layout matches
+    uint32_t service_record_size;
+    uint32_t calling_point_record_size;
+    uint32_t service_count;
+    uint32_t calling_point_count;
+    uint32_t string_pool_size;
+    uint64_t data_version;                  // Parser data version of the board
+    int64_t created;                        // When the snapshot was written (Unix time)
+    uint64_t services_offset;               // Section offsets from the start of the file
+    uint64_t calling_points_offset;
+    uint64_t string_pool_offset;
+    uint64_t file_size;
+    SnapshotString location_name;
+    SnapshotString nrcc_message;
+    uint32_t dropped_services;              // Malformed services dropped by the parser
+    uint32_t reserved;
+};
+
+struct SnapshotService {
+    SnapshotString scheduledTime;
+    SnapshotString estimatedTime;
+    SnapshotString platform;
+    SnapshotString destination;
+    SnapshotString destinationCRS;
+    SnapshotString operator_raw;            // The display name is made from it on load
+    SnapshotString operatorCode;
+    SnapshotString coaches;
+    SnapshotString cancelReason;
+    SnapshotString delayReason;
+    SnapshotString adhocAlerts;
+    SnapshotString serviceID;
+    uint32_t first_calling_point;           // Index of this service's first calling point
+    uint32_t calling_point_count;
+    uint8_t isCancelled;
+    uint8_t isDelayed;
+    uint8_t reserved[2];
+};
+
+struct SnapshotCallingPoint {
+    SnapshotString locationName;
+    SnapshotString crs;
+    SnapshotString scheduledTime;
+    SnapshotString estimatedTime;
+};
+
+static_assert(sizeof(SnapshotHeader) == 112, "SnapshotHeader layout has changed - bump BOARD_SNAPSHOT_VERSION");
+static_assert(sizeof(SnapshotService) == 108, "SnapshotService layout has changed - bump BOARD_SNAPSHOT_VERSION");
+static_assert(sizeof(SnapshotCallingPoint) == 32, "SnapshotCallingPoint layout has changed - bump BOARD_SNAPSHOT_VERSION");
+
+/**
+ * Encode a parsed board as a snapshot image
+ * Repeated strings (calling points shared by several services) are stored once
+ * @param services The parsed services
+ * @param location_name The location of the departure board
+ * @param nrcc_message The decoded NRCC messages
+ * @param data_version The parser data version of this board
+ * @param dropped_services The number of malformed services dropped by the parser
+ * @param image The buffer to encode into (replaced)
+ */
+void encodeBoardSnapshot(const std::vector<TrainServiceParser::TrainServiceInfo>& services,
+                         const std::string& location_name,
+                         const std::string& nrcc_message,
+                         uint64_t data_version,
+                         size_t dropped_services,
+                         std::vector<char>& image);
+
+/**
+ * Write a snapshot image to a file atomically
+ * The image is written to '<path>.tmp', synced to disk and renamed over path, so a reader
+ * sees either the previous snapshot or the new one - never a partial file
+ * @param path The snapshot file
+ * @param image The encoded snapshot
+ * @throws std::runtime_error if the file can't be written
+ */
+void writeBoardSnapshot(const std::string& path, const std::vector<char>& image);
+
+// A read-only view of a snapshot - a mapped file or a buffer - read in place without copying
+// The whole snapshot is validated when the view is created, so the accessors don't need to check
+class BoardSnapshot {
+public:
+    struct Text {                           // A string in the snapshot - valid while the view exists
+        const char* data;
+        size_t length;
+    };
+
+    /**
+     * Map a snapshot file into memory
+     * @param path The snapshot file
+     * @throws std::runtime_error if the file can't be mapped or isn't a valid snapshot
+     */
+    explicit BoardSnapshot(const std::string& path);
+
+    /**
+     * View a snapshot image already in memory (not copied - the buffer must outlive the view)
+     * @param data The snapshot image
+     * @param size The size of the image in bytes
+     * @throws std::runtime_error if the image isn't a valid snapshot
+     */
+    BoardSnapshot(const void* data, size_t size);
+
+    ~BoardSnapshot();
+
+    BoardSnapshot(const BoardSnapshot&) = delete;
+    BoardSnapshot& operator=(const BoardSnapshot&) = delete;
+
+    const SnapshotHeader& header() const { return *hdr; }
+    size_t serviceCount() const { return hdr->service_count; }
+    const SnapshotService& service(size_t serviceIndex) const { return services[serviceIndex]; }
+    const SnapshotCallingPoint& callingPoint(const SnapshotService& service, size_t pointIndex) const {
+        return calling_points[service.first_calling_point + pointIndex];
+    }
+    Text text(const SnapshotString& str) const { return Text{string_pool + str.offset, str.length}; }
+    Text locationName() const { return text(hdr->location_name); }
+    Text nrccMessage() const { return text(hdr->nrcc_message); }
+
+private:
+    const char* base;
+    size_t size;
+    bool mapped;                            // Unmap in the destructor?
+
+    const SnapshotHeader* hdr;
+    const SnapshotService* services;
+    const SnapshotCallingPoint* calling_points;
+    const char* string_pool;
+
+    void validate();
+    void validateString(const SnapshotString& str) const;
+};
+
+#endif // BOARD_SNAPSHOT_H
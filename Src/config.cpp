@@ -23,6 +23,7 @@ void Config::loadFromFile(const std::string& filename) {
     }
 
     std::string line;
+    std::set<std::string> loaded;
     while (std::getline(file, line)) {
         // Skip empty lines and comments
         if (line.empty() || line[0] == '#') continue;
@@ -36,16 +37,44 @@ void Config::loadFromFile(const std::string& filename) {
         if (!key.empty()) {
             // Set the value, even if it's empty - we'll handle fallbacks in get()
             settings[key] = value;
+            loaded.insert(key);
             DEBUG_PRINT("Loaded config: " << key << " = " << (value.empty() ? "<empty>" : value));
         }
     }
     
+    mapRetiredSettings(loaded);
+    
     // Clear cache after loading new configuration
     clearCache();
     
     DEBUG_PRINT("Configuration loaded successfully from " << filename);
 }
 
+// Settings that have been replaced - a config file written for an earlier version scrolls at about the same
+// speed as it did, with a warning saying what to set instead
+void Config::mapRetiredSettings(const std::set<std::string>& loaded) {
+    auto slowdown = settings.find("scroll_slowdown_sleep_ms");
+    if (slowdown == settings.end()) {
+        return;
+    }
+    // The text used to move a pixel and then sleep for scroll_slowdown_sleep_ms
+    int sleep_ms = 1;
+    try {
+        sleep_ms = std::max(std::stoi(slowdown->second), 1);
+    } catch (const std::exception&) {
+    }
+    const std::string speed = std::to_string(1000 / sleep_ms);
+    for (const char* key : {"calling_points_scroll_speed", "message_scroll_speed"}) {
+        if (!loaded.count(key)) {
+            settings[key] = speed;
+        }
+    }
+    std::cerr << "Warning: scroll_slowdown_sleep_ms is no longer used - set calling_points_scroll_speed and "
+              << "message_scroll_speed (pixels per second) instead. Scrolling at " << speed
+              << " pixels per second where they aren't set" << std::endl;
+    settings.erase(slowdown);
+}
+
 std::string Config::get(const std::string& key) const {
     // First check the cache
     auto cache_it = value_cache.find(key);
@@ -67,7 +96,7 @@ std::string Config::get(const std::string& key) const {
                 result = default_it->second;
             } else {
                 // Both settings and defaults have empty values
-                if (key == "to" || key == "platform" || key == "led-pixel-mapper" || key == "led-panel-type") {
+                if (key == "to" || key == "platform" || key == "filter" || key == "snapshot_path" || key == "capture_path" || key == "font_atlas_path" || key == "render_thread_cpus" || key == "refresh_thread_cpus" || key == "presenter_thread_cpus" || key == "led-pixel-mapper" || key == "led-panel-type") {
                     // These keys are allowed to be empty
                     result = "";
                 } else {
@@ -18,6 +18,7 @@
 #include <algorithm>
 #include <cctype>
 #include <memory>
+#include <set>
 #include <utility>
 
 // Forward declaration for the debug printing macro
@@ -38,8 +39,20 @@ private:
         {"APIkey", ""},
         {"Rail_Data_Marketplace", ""},
         {"fontPath", ""},
-        {"scroll_slowdown_sleep_ms", "15"},
+        {"font_atlas_path", "/tmp/traindisplay_font.atlas"},
+        {"frame_rate", "60"},
+        {"frame_queue_depth", "0"},
+        {"frame_stats_path", "/tmp/traindisplay_frame_stats.txt"},
+        {"render_thread_priority", "0"},
+        {"render_thread_cpus", ""},
+        {"refresh_thread_priority", "0"},
+        {"refresh_thread_cpus", ""},
+        {"presenter_thread_priority", "0"},
+        {"presenter_thread_cpus", ""},
+        {"calling_points_scroll_speed", "60"},
+        {"message_scroll_speed", "60"},
         {"refresh_interval_seconds", "60"},
+        {"api_timeout_seconds", "30"},
         {"Message_Refresh_interval", "20"},
         {"matrixcols", "128"},
         {"matrixrows", "64"},
@@ -52,11 +65,18 @@ private:
         {"third_line_y", "58"},
         {"fourth_line_y", "72"},
         {"third_line_refresh_seconds", "10"},
+        {"third_line_scroll_speed", "30"},
         {"ETD_coach_refresh_seconds", "3"},
         {"ShowCallingPointETD", "Yes"},
         {"ShowMessages", "Yes"},
         {"ShowPlatforms", "Yes"},
         {"platform", ""},
+        {"filter", ""},
+        {"local_destination_filter", "No"},
+        {"snapshot_path", ""},
+        {"capture_path", ""},
+        {"capture_format", "ppm"},
+        {"capture_every", "1"},
         
         // RGB Matrix defaults
         {"led-multiplexing", "0"},
@@ -86,6 +106,9 @@ private:
     void configureMatrixOptions(RGBMatrix::Options& options) const;
     void configureRuntimeOptions(RuntimeOptions& runtime_opt) const;
     
+    // Carry settings from an earlier version over to the ones that replaced them (warning that they're retired)
+    void mapRetiredSettings(const std::set<std::string>& loaded);
+    
     // Helper to convert a string to lowercase for case-insensitive comparisons
     std::string toLower(std::string str) const {
         std::transform(str.begin(), str.end(), str.begin(),
@@ -0,0 +1,77 @@
+// Train Display - an RGB matrix departure board for the Raspberry Pi
+// Damage tracker
+// Version 1.0
+// Instructions, fixes and issues at https://github.com/jonmorrissmith/RGB_Matrix_Train_Departure_Board
+//
+#include "damage_tracker.h"
+#include <algorithm>
+#include <iomanip>
+
+Rect Rect::intersect(const Rect& other) const {
+    int left = std::max(x, other.x);
+    int top = std::max(y, other.y);
+    int right = std::min(x + width, other.x + other.width);
+    int bottom = std::min(y + height, other.y + other.height);
+    if (right <= left || bottom <= top) {
+        return Rect();
+    }
+    return Rect(left, top, right - left, bottom - top);
+}
+
+DamageTracker::DamageTracker() : changed_regions(ALL), back(0), frames(0), total_pixels(0), max_pixels(0) {
+    // Both canvases start blank, so everything needs drawing
+    for (int i = 0; i < CANVASES; i++) {
+        stale_regions[i] = ALL;
+    }
+}
+
+void DamageTracker::damage(unsigned regions) {
+    for (int i = 0; i < CANVASES; i++) {
+        stale_regions[i] |= regions;
+    }
+    changed_regions |= regions;
+}
+
+unsigned DamageTracker::takeChanged() {
+    unsigned changed = changed_regions;
+    changed_regions = 0;
+    return changed;
+}
+
+void DamageTracker::repaired(uint64_t pixels) {
+    stale_regions[back] = 0;
+    frames++;
+    total_pixels += pixels;
+    if (pixels > max_pixels) {
+        max_pixels = pixels;
+    }
+}
+
+void DamageTracker::writeReport(std::ostream& out) const {
+    out << "pixel_writes: frames=" << frames << " total=" << total_pixels
+        << " mean_per_frame=" << std::fixed << std::setprecision(1)
+        << (frames ? static_cast<double>(total_pixels) / frames : 0.0)
+        << " max_per_frame=" << max_pixels << std::endl;
+}
+
+ClippedCanvas::ClippedCanvas(rgb_matrix::Canvas* target, const Rect& clip_rect)
+    : canvas(target),
+      clip(clip_rect.intersect(Rect(0, 0, target->width(), target->height()))),
+      pixels(0) {
+}
+
+void ClippedCanvas::SetPixel(int x, int y, uint8_t red, uint8_t green, uint8_t blue) {
+    if (clip.contains(x, y)) {
+        canvas->SetPixel(x, y, red, green, blue);
+        pixels++;
+    }
+}
+
+void ClippedCanvas::Fill(uint8_t red, uint8_t green, uint8_t blue) {
+    for (int y = clip.y; y < clip.y + clip.height; y++) {
+        for (int x = clip.x; x < clip.x + clip.width; x++) {
+            canvas->SetPixel(x, y, red, green, blue);
+        }
+    }
+    pixels += static_cast<uint64_t>(clip.width) * clip.height;
+}
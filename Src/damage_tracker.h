@@ -0,0 +1,113 @@
+// Train Display - an RGB matrix departure board for the Raspberry Pi
+// Damage tracker
+// Version 1.0
+// Instructions, fixes and issues at https://github.com/jonmorrissmith/RGB_Matrix_Train_Departure_Board
+//
+// Keeps track of which regions of the board need redrawing, separately for each of the two canvases
+// the matrix swaps between.
+//
+// After SwapOnVSync the canvas we draw into holds the frame from two swaps ago, so a change has to be
+// drawn once into each canvas. Damage is marked against both; drawing a frame repairs the regions that
+// are stale in the canvas being drawn, and the other canvas is repaired when it next comes round. There's
+// no need to draw a second frame straight away - the frame on screen is always complete.
+//
+// Regions are drawn once into the display's own frame buffer (see frame_buffer.h) and copied from there into each
+// canvas - so as well as what's stale in each canvas, the tracker keeps what's changed since the frame buffer
+// was last drawn.
+//
+// ClippedCanvas is how a region is redrawn: anything drawn through it lands only inside the region, so
+// text that overlaps a neighbouring region is drawn without disturbing it.
+//
+#ifndef DAMAGE_TRACKER_H
+#define DAMAGE_TRACKER_H
+
+#include <canvas.h>
+#include <cstdint>
+#include <ostream>
+
+// A rectangle of pixels - x and y are the top-left corner
+struct Rect {
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+
+    Rect() = default;
+    Rect(int x_origin, int y_origin, int w, int h) : x(x_origin), y(y_origin), width(w), height(h) {}
+
+    bool empty() const { return width <= 0 || height <= 0; }
+    bool contains(int px, int py) const { return px >= x && px < x + width && py >= y && py < y + height; }
+    Rect intersect(const Rect& other) const;
+};
+
+class DamageTracker {
+public:
+    static const int CANVASES = 2;                          // The matrix double-buffers
+    static const unsigned ALL = ~0u;                        // Everything - the canvas is cleared and redrawn
+
+    DamageTracker();
+
+    /**
+     * Mark regions as needing a redraw on every canvas
+     * @param regions Bit mask of regions (the meaning of each bit is up to the caller)
+     */
+    void damage(unsigned regions);
+    void damageAll() { damage(ALL); }
+
+    // Regions stale in the canvas about to be drawn
+    unsigned stale() const { return stale_regions[back]; }
+
+    /**
+     * Regions changed since the last call - these need drawing into the frame buffer
+     * @return Bit mask of regions (ALL after damageAll)
+     */
+    unsigned takeChanged();
+
+    // Has anything changed since the last frame? If not the frame on screen is already right
+    bool hasChanges() const { return changed_regions != 0; }
+
+    /**
+     * The canvas about to be drawn has been brought up to date
+     * @param pixels Pixels written while doing it
+     */
+    void repaired(uint64_t pixels);
+
+    // Call after each SwapOnVSync - the other canvas is the one to draw next
+    void swapped() { back = (back + 1) % CANVASES; }
+
+    /**
+     * Write the pixel write statistics since start-up
+     * @param out The stream to write to
+     */
+    void writeReport(std::ostream& out) const;
+
+private:
+    unsigned stale_regions[CANVASES];
+    unsigned changed_regions;
+    int back;                                               // Index of the canvas being drawn
+
+    uint64_t frames;
+    uint64_t total_pixels;
+    uint64_t max_pixels;
+};
+
+// A canvas that only passes through pixels inside a clip rectangle (and counts them)
+class ClippedCanvas : public rgb_matrix::Canvas {
+public:
+    ClippedCanvas(rgb_matrix::Canvas* target, const Rect& clip);
+
+    int width() const override { return canvas->width(); }
+    int height() const override { return canvas->height(); }
+    void SetPixel(int x, int y, uint8_t red, uint8_t green, uint8_t blue) override;
+    void Clear() override { Fill(0, 0, 0); }                // Clears the clip rectangle only
+    void Fill(uint8_t red, uint8_t green, uint8_t blue) override;
+
+    uint64_t pixelsWritten() const { return pixels; }
+
+private:
+    rgb_matrix::Canvas* canvas;
+    Rect clip;
+    uint64_t pixels;
+};
+
+#endif // DAMAGE_TRACKER_H
@@ -0,0 +1,149 @@
+// Train Display - an RGB matrix departure board for the Raspberry Pi
+// Display backends
+// Version 1.0
+// Instructions, fixes and issues at https://github.com/jonmorrissmith/RGB_Matrix_Train_Departure_Board
+//
+#include "display_backend.h"
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+MatrixBackend::MatrixBackend(rgb_matrix::RGBMatrix* m) : matrix(m), back(m->CreateFrameCanvas()) {
+}
+
+// The library runs its refresh thread at SCHED_FIFO 99 and pins it to core 3 when there is one
+int MatrixBackend::refreshCpu() const {
+    return sysconf(_SC_NPROCESSORS_CONF) > 3 ? 3 : -1;
+}
+
+HeadlessBackend::HeadlessBackend(int w, int h)
+    : buffer_width(w > 0 ? w : 0),
+      buffer_height(h > 0 ? h : 0),
+      back(0),
+      have_shown(false),
+      capture_format(PPM),
+      capture_every(1),
+      frames(0),
+      changed_total(0),
+      changed_max(0),
+      changed_last(0),
+      unchanged_frames(0) {
+    buffers[0].reset(new FrameBuffer(buffer_width, buffer_height));
+    buffers[1].reset(new FrameBuffer(buffer_width, buffer_height));
+}
+
+void HeadlessBackend::setCapture(const std::string& directory, CaptureFormat format, int every) {
+    capture_directory = directory;
+    capture_format = format;
+    capture_every = every < 1 ? 1 : every;
+}
+
+void HeadlessBackend::swap() {
+    const FrameBuffer& drawn = *buffers[back];
+    frames++;
+
+    // Count the pixels that differ from the frame on screen
+    uint64_t changed = 0;
+    if (have_shown) {
+        const FrameBuffer& previous = *buffers[1 - back];
+        for (int y = 0; y < buffer_height; y++) {
+            const uint8_t* a = drawn.row(y);
+            const uint8_t* b = previous.row(y);
+            if (std::memcmp(a, b, static_cast<size_t>(buffer_width) * 3) == 0) {
+                continue;
+            }
+            for (int x = 0; x < buffer_width * 3; x += 3) {
+                if (a[x] != b[x] || a[x + 1] != b[x + 1] || a[x + 2] != b[x + 2]) {
+                    changed++;
+                }
+            }
+        }
+    } else {
+        changed = static_cast<uint64_t>(buffer_width) * buffer_height;
+    }
+    changed_last = changed;
+    changed_total += changed;
+    if (changed > changed_max) {
+        changed_max = changed;
+    }
+    if (changed == 0) {
+        unchanged_frames++;
+    }
+
+    if (!capture_directory.empty() && frames % capture_every == 0) {
+        char name[32];
+        snprintf(name, sizeof(name), "/frame_%06llu.%s", static_cast<unsigned long long>(frames),
+                 capture_format == PPM ? "ppm" : "planes");
+        try {
+            if (capture_format == PPM) {
+                writePPM(drawn, capture_directory + name);
+            } else {
+                writeBitplanes(drawn, capture_directory + name);
+            }
+        } catch (const std::exception& e) {
+            // Don't stop the display for a capture - just stop capturing
+            std::cerr << "Frame capture stopped: " << e.what() << std::endl;
+            capture_directory.clear();
+        }
+    }
+
+    // The frame just drawn is now on screen, and the old one is drawn into next
+    have_shown = true;
+    back = 1 - back;
+}
+
+void HeadlessBackend::writeReport(std::ostream& out) const {
+    out << "headless: frames=" << frames
+        << " changed_pixels_total=" << changed_total
+        << " mean_changed_per_frame=" << std::fixed << std::setprecision(1)
+        << (frames ? static_cast<double>(changed_total) / frames : 0.0)
+        << " max_changed=" << changed_max
+        << " last_changed=" << changed_last
+        << " unchanged_frames=" << unchanged_frames << std::endl;
+}
+
+void HeadlessBackend::writePPM(const FrameBuffer& frame, const std::string& path) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        throw std::runtime_error("Cannot write frame to " + path);
+    }
+    out << "P6\n" << frame.width() << " " << frame.height() << "\n255\n";
+    for (int y = 0; y < frame.height(); y++) {
+        out.write(reinterpret_cast<const char*>(frame.row(y)), static_cast<std::streamsize>(frame.width()) * 3);
+    }
+    if (!out) {
+        throw std::runtime_error("Error writing frame to " + path);
+    }
+}
+
+void HeadlessBackend::writeBitplanes(const FrameBuffer& frame, const std::string& path) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        throw std::runtime_error("Cannot write frame to " + path);
+    }
+    size_t row_bytes = static_cast<size_t>(frame.width() + 7) / 8;
+    std::vector<char> packed(row_bytes);
+    for (int channel = 0; channel < 3; channel++) {
+        for (int bit = 7; bit >= 0; bit--) {
+            for (int y = 0; y < frame.height(); y++) {
+                const uint8_t* pixel = frame.row(y) + channel;
+                std::fill(packed.begin(), packed.end(), 0);
+                for (int x = 0; x < frame.width(); x++, pixel += 3) {
+                    if ((*pixel >> bit) & 1) {
+                        packed[x / 8] |= static_cast<char>(0x80 >> (x % 8));
+                    }
+                }
+                out.write(packed.data(), static_cast<std::streamsize>(row_bytes));
+            }
+        }
+    }
+    if (!out) {
+        throw std::runtime_error("Error writing frame to " + path);
+    }
+}
@@ -0,0 +1,126 @@
+// Train Display - an RGB matrix departure board for the Raspberry Pi
+// Display backends
+// Version 1.0
+// Instructions, fixes and issues at https://github.com/jonmorrissmith/RGB_Matrix_Train_Departure_Board
+//
+// What the display draws into. A backend hands out the canvas for the next frame and shows it when the
+// frame is finished, double-buffered like the matrix.
+//
+// MatrixBackend   the RGB matrix - the canvas is a FrameCanvas and showing a frame is SwapOnVSync
+// HeadlessBackend in memory - for running and benchmarking the display without a Pi. It counts the pixels
+//                 that change from frame to frame and can save frames as PPM images or raw bitplanes
+//
+#ifndef DISPLAY_BACKEND_H
+#define DISPLAY_BACKEND_H
+
+#include <led-matrix.h>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include "frame_buffer.h"
+
+class DisplayBackend {
+public:
+    virtual ~DisplayBackend() {}
+
+    virtual int width() const = 0;
+    virtual int height() const = 0;
+
+    // The canvas to draw the next frame into - it holds the frame from two swaps ago
+    virtual rgb_matrix::Canvas* canvas() = 0;
+
+    // Show the frame just drawn - returns once it's on screen
+    virtual void swap() = 0;
+
+    /**
+     * Write anything the backend measures (added to the frame statistics)
+     * @param out The stream to write to
+     */
+    virtual void writeReport(std::ostream& out) const { (void)out; }
+
+    // The CPU the panel refresh thread is pinned to, or -1 if there isn't one
+    virtual int refreshCpu() const { return -1; }
+};
+
+class MatrixBackend : public DisplayBackend {
+public:
+    /**
+     * @param m The matrix - owned by the caller
+     */
+    explicit MatrixBackend(rgb_matrix::RGBMatrix* m);
+
+    int width() const override { return matrix->width(); }
+    int height() const override { return matrix->height(); }
+    rgb_matrix::Canvas* canvas() override { return back; }
+    void swap() override { back = matrix->SwapOnVSync(back); }
+    int refreshCpu() const override;
+
+private:
+    rgb_matrix::RGBMatrix* matrix;
+    rgb_matrix::FrameCanvas* back;
+};
+
+class HeadlessBackend : public DisplayBackend {
+public:
+    enum CaptureFormat { PPM, BITPLANES };
+
+    /**
+     * @param w Width in pixels
+     * @param h Height in pixels
+     */
+    HeadlessBackend(int w, int h);
+
+    /**
+     * Save frames as they're shown
+     * @param directory Where to write them (frame_000001.ppm and so on) - empty for none
+     * @param format PPM (binary P6) or BITPLANES (see README)
+     * @param every Save every nth frame
+     */
+    void setCapture(const std::string& directory, CaptureFormat format, int every);
+
+    int width() const override { return buffer_width; }
+    int height() const override { return buffer_height; }
+    rgb_matrix::Canvas* canvas() override { return buffers[back].get(); }
+    void swap() override;
+    void writeReport(std::ostream& out) const override;
+
+    // The frame on screen
+    const FrameBuffer& shown() const { return *buffers[1 - back]; }
+
+    /**
+     * Write a frame as a binary PPM (P6) image
+     * @param frame The frame
+     * @param path The file to write
+     * @throws std::runtime_error if the file can't be written
+     */
+    static void writePPM(const FrameBuffer& frame, const std::string& path);
+
+    /**
+     * Write a frame as raw bitplanes - for each of red, green and blue, bits 7 to 0, one bit per pixel,
+     * each row packed most significant bit first into (width + 7) / 8 bytes
+     * @param frame The frame
+     * @param path The file to write
+     * @throws std::runtime_error if the file can't be written
+     */
+    static void writeBitplanes(const FrameBuffer& frame, const std::string& path);
+
+private:
+    int buffer_width;
+    int buffer_height;
+    std::unique_ptr<FrameBuffer> buffers[2];
+    int back;                                               // The buffer being drawn
+    bool have_shown;                                        // Has a frame been shown yet (to compare with)
+
+    std::string capture_directory;
+    CaptureFormat capture_format;
+    int capture_every;
+
+    uint64_t frames;
+    uint64_t changed_total;
+    uint64_t changed_max;
+    uint64_t changed_last;
+    uint64_t unchanged_frames;
+};
+
+#endif // DISPLAY_BACKEND_H
@@ -0,0 +1,48 @@
+// Train Display - an RGB matrix departure board for the Raspberry Pi
+// Display model
+// Version 1.0
+// Instructions, fixes and issues at https://github.com/jonmorrissmith/RGB_Matrix_Train_Departure_Board
+//
+#include "display_model.h"
+
+namespace {
+
+// DisplayText's own == only compares x positions, so compare what gets drawn
+bool sameText(const DisplayText& a, const DisplayText& b) {
+    return a.text == b.text && a.width == b.width &&
+           a.x_position == b.x_position && a.y_position == b.y_position;
+}
+
+} // namespace
+
+bool DisplayModel::sameContent(const DisplayModel& other) const {
+    return num_services == other.num_services && changedRows(other) == 0;
+}
+
+unsigned DisplayModel::changedRows(const DisplayModel& other) const {
+    unsigned changed = 0;
+    if (has_first_service != other.has_first_service ||
+        !sameText(first_departure, other.first_departure) ||
+        !sameText(first_departure_etd, other.first_departure_etd) ||
+        !sameText(first_departure_coaches, other.first_departure_coaches)) {
+        changed |= FIRST_ROW;
+    }
+    // 'Calling at:' is only drawn with a first departure
+    if (has_first_service != other.has_first_service ||
+        scroll_calling_points != other.scroll_calling_points ||
+        !sameText(calling_points_text, other.calling_points_text)) {
+        changed |= SECOND_ROW;
+    }
+    if (!sameText(second_departure, other.second_departure) ||
+        !sameText(second_departure_etd, other.second_departure_etd) ||
+        !sameText(third_departure, other.third_departure) ||
+        !sameText(third_departure_etd, other.third_departure_etd)) {
+        changed |= THIRD_ROW;
+    }
+    if (has_message != other.has_message ||
+        !sameText(location_name_text, other.location_name_text) ||
+        !sameText(nrcc_message_text, other.nrcc_message_text)) {
+        changed |= FOURTH_ROW;
+    }
+    return changed;
+}
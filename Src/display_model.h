@@ -0,0 +1,74 @@
+// Train Display - an RGB matrix departure board for the Raspberry Pi
+// Display model
+// Version 1.0
+// Instructions, fixes and issues at https://github.com/jonmorrissmith/RGB_Matrix_Train_Departure_Board
+//
+// A DisplayModel is everything the render loop needs to draw one board - the text of each line with
+// its width and position, and the flags that go with it. It's built on the refresh worker, after the
+// fetch and parse, and is never changed once published: the worker hands it to the render loop as a
+// shared_ptr<const DisplayModel> and the render loop adopts it between frames.
+//
+// Anything that changes from frame to frame (scroll positions, row toggles, the clock) belongs to the
+// render loop and is kept out of the model.
+//
+#ifndef DISPLAY_MODEL_H
+#define DISPLAY_MODEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include "display_text.h"
+#include "text_strip.h"
+
+struct DisplayModel {
+    uint64_t data_version = 0;              // Parser data version the model was built from
+    size_t num_services = 0;                // The number of services available
+
+    // Top line - first departure, with the ETD and coaches right-justified
+    bool has_first_service = false;         // Is there a first departure (otherwise 'No more services')
+    DisplayText first_departure;
+    DisplayText first_departure_etd;
+    DisplayText first_departure_coaches;
+
+    // Second line - calling points (or the cancellation reason) for the first departure
+    DisplayText calling_points_text;        // x_position isn't used - the render loop scrolls it
+    TextStrip calling_points_strip;         // calling_points_text rendered, ready to scroll
+    bool scroll_calling_points = false;     // Too wide for the space after 'Calling at:'?
+
+    // Third line - 2nd and 3rd departures, with the ETD right-justified
+    DisplayText second_departure;
+    DisplayText second_departure_etd;
+    DisplayText third_departure;
+    DisplayText third_departure_etd;
+
+    // Fourth line - location or NRCC messages
+    DisplayText location_name_text;
+    DisplayText nrcc_message_text;          // x_position isn't used - the render loop scrolls it
+    TextStrip nrcc_message_strip;           // nrcc_message_text rendered, ready to scroll
+    bool has_message = false;
+
+    /**
+     * Would this model draw exactly the same board as another?
+     * Used by the worker to skip publishing a refresh that changed nothing on screen
+     * @param other The model to compare with
+     * @return true if every line's text, width and position match
+     */
+    bool sameContent(const DisplayModel& other) const;
+
+    // Rows of the board, as a bit mask
+    enum Row {
+        FIRST_ROW = 1,          // First departure, ETD and coaches
+        SECOND_ROW = 2,         // 'Calling at:' and the calling points
+        THIRD_ROW = 4,          // 2nd and 3rd departures
+        FOURTH_ROW = 8          // Location and messages
+    };
+
+    /**
+     * Which rows would be drawn differently from another model
+     * Used by the render loop to redraw only what a new model changed
+     * @param other The model to compare with
+     * @return Bit mask of Row values
+     */
+    unsigned changedRows(const DisplayModel& other) const;
+};
+
+#endif // DISPLAY_MODEL_H
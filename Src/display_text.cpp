@@ -11,16 +11,38 @@
 #include <algorithm>
 #include <utility>
 
+namespace {
+
+// Build the glyph and offset tables for a text - each character decoded and normalised once, here
+void buildGlyphOffsets(const std::string& text, const FontCache& fontsizes, std::vector<uint32_t>& glyphs, std::vector<int>& offsets) {
+    glyphs.clear();
+    offsets.clear();
+    int x = 0;
+    for (size_t i = 0; i < text.size();) {
+        uint32_t codepoint = fontsizes.normalise(FontCache::decodeUTF8(text, i));
+        glyphs.push_back(codepoint);
+        offsets.push_back(x);
+        x += fontsizes.getGlyphWidth(codepoint);
+    }
+    offsets.push_back(x);
+}
+
+} // namespace
+
 //-------------------------------------------------------------------------
 // FontCache implementation
 //-------------------------------------------------------------------------
 
-void FontCache::setFont(const Font& font) {
+void FontCache::setFont(const GlyphAtlas& font) {
     try {
-        font_ptr = &font;
-        // Cache character widths
-        for (int i = 0; i < 256; i++) {
-            char_widths[i] = font.CharacterWidth(static_cast<char>(i));
+        atlas = &font;
+        // Missing glyphs are drawn as the replacement character (or not at all)
+        int replacement = font.characterWidth(0xFFFD);
+        replacement_width = replacement > 0 ? replacement : 0;
+        // Cache ASCII character widths
+        for (int i = 0; i < 128; i++) {
+            int width = font.characterWidth(static_cast<uint32_t>(i));
+            ascii_widths[i] = width >= 0 ? width : replacement_width;
         }
         // Cache font baseline
         baseline = font.baseline();
@@ -31,21 +53,54 @@ void FontCache::setFont(const Font& font) {
     }
 }
 
-int FontCache::getCharWidth(char c) const {
-    try {
-        unsigned char idx = static_cast<unsigned char>(c);
-        return char_widths[idx];
-    } catch (const std::exception& e) {
-        DEBUG_PRINT("Error in FontCache::getCharWidth: " << e.what());
-        throw std::out_of_range("Character out of range in FontCache::getCharWidth");
+uint32_t FontCache::decodeUTF8(const std::string& text, size_t& i) {
+    unsigned char c = static_cast<unsigned char>(text[i++]);
+    if (c < 0x80) {
+        return c;
+    }
+    int extra = (c >= 0xF0) ? 3 : (c >= 0xE0) ? 2 : (c >= 0xC0) ? 1 : 0;
+    uint32_t codepoint = c & (0x3F >> extra);
+    while (extra-- > 0 && i < text.size()) {
+        codepoint = (codepoint << 6) | (static_cast<unsigned char>(text[i++]) & 0x3F);
+    }
+    return codepoint;
+}
+
+uint32_t FontCache::normalise(uint32_t codepoint) const {
+    if (codepoint < 128 || (atlas && atlas->characterWidth(codepoint) >= 0)) {
+        return codepoint;
+    }
+    switch (codepoint) {
+        case 0x2018: case 0x2019: case 0x201A: case 0x2032:     // Single quotes and prime
+            return '\'';
+        case 0x201C: case 0x201D: case 0x201E: case 0x2033:     // Double quotes and double prime
+            return '"';
+        case 0x2010: case 0x2011: case 0x2012: case 0x2013: case 0x2014: case 0x2212:   // Hyphens, dashes and minus
+            return '-';
+        case 0x00A0: case 0x2007: case 0x2009: case 0x202F:     // Non-breaking and thin spaces
+            return ' ';
+        default:
+            return codepoint;
     }
 }
 
+int FontCache::getCharWidth(char c) const {
+    unsigned char idx = static_cast<unsigned char>(c);
+    return idx < 128 ? ascii_widths[idx] : 0;
+}
+
 int FontCache::getTextWidth(const std::string& text) const {
     try {
         int width = 0;
-        for (const char& c : text) {
-            width += getCharWidth(c);
+        for (size_t i = 0; i < text.size();) {
+            // ASCII straight from the table
+            unsigned char c = static_cast<unsigned char>(text[i]);
+            if (c < 0x80) {
+                width += ascii_widths[c];
+                i++;
+            } else {
+                width += getGlyphWidth(normalise(decodeUTF8(text, i)));
+            }
         }
         return width;
     } catch (const std::exception& e) {
@@ -54,6 +109,14 @@ int FontCache::getTextWidth(const std::string& text) const {
     }
 }
 
+int FontCache::getGlyphWidth(uint32_t codepoint) const {
+    if (codepoint < 128) {
+        return ascii_widths[codepoint];
+    }
+    int width = atlas ? atlas->characterWidth(codepoint) : -1;
+    return width >= 0 ? width : replacement_width;
+}
+
 int FontCache::getBaseline(){
     return baseline;
 }
@@ -73,7 +136,8 @@ DisplayText::DisplayText(const std::string& t, int w, int x, int y, uint64_t v)
 void DisplayText::setTextAndWidth(const std::string& newText, const FontCache& fontsizes) {
     try {
         text = newText;
-        width = fontsizes.getTextWidth(text);
+        buildGlyphOffsets(text, fontsizes, glyphs, glyph_offsets);
+        width = glyph_offsets.back();
     } catch (const std::exception& e) {
         DEBUG_PRINT("Error in DisplayText::setTextAndWidth: " << e.what());
         throw std::runtime_error("Error setting text and width: " + std::string(e.what()));
@@ -82,13 +146,31 @@ void DisplayText::setTextAndWidth(const std::string& newText, const FontCache& f
 
 void DisplayText::setWidth(const FontCache& fontsizes) {
     try {
-        width = fontsizes.getTextWidth(text);
+        buildGlyphOffsets(text, fontsizes, glyphs, glyph_offsets);
+        width = glyph_offsets.back();
     } catch (const std::exception& e) {
         DEBUG_PRINT("Error in DisplayText::setWidth: " << e.what());
         throw std::runtime_error("Error setting width: " + std::string(e.what()));
     }
 }
 
+void DisplayText::draw(Canvas* canvas, const GlyphAtlas& font, int x, int y, const Color& color, int clip_left, int clip_right) const {
+    if (glyph_offsets.size() != glyphs.size() + 1) {
+        for (size_t i = 0; i < text.size() && x < clip_right;) {
+            x += font.drawGlyph(canvas, x, y, color, FontCache::decodeUTF8(text, i), clip_left, clip_right);
+        }
+        return;
+    }
+    // The last glyph starting at or before the left edge - and one before that in case it overhangs
+    auto start = std::upper_bound(glyph_offsets.begin(), glyph_offsets.end() - 1, clip_left - x);
+    size_t first = static_cast<size_t>(start - glyph_offsets.begin());
+    first = (first > 1) ? first - 2 : 0;
+    
+    for (size_t i = first; i < glyphs.size() && x + glyph_offsets[i] < clip_right; i++) {
+        font.drawGlyph(canvas, x + glyph_offsets[i], y, color, glyphs[i], clip_left, clip_right);
+    }
+}
+
 bool DisplayText::empty() {
     return text.empty();
 }
@@ -96,6 +178,7 @@ bool DisplayText::empty() {
 DisplayText& DisplayText::operator=(const std::string& str) {
     try {
         text = str;
+        glyph_offsets.clear();
     } catch (const std::exception& e) {
         DEBUG_PRINT("Error in DisplayText::operator=: " << e.what());
         throw std::runtime_error("Error assigning string to DisplayText: " + std::string(e.what()));
@@ -118,6 +201,7 @@ DisplayText& DisplayText::operator<<(const std::string& str) {
             text.reserve(text.size() + str.size());
             text.append(str);  // More efficient than concatenation operator
         }
+        glyph_offsets.clear();
     } catch (const std::exception& e) {
         DEBUG_PRINT("Error in DisplayText::operator<<: " << e.what());
         throw std::runtime_error("Error in string concatenation: " + std::string(e.what()));
@@ -175,6 +259,8 @@ DisplayText DisplayText::operator--(int) {
 
 void DisplayText::reset() {
     text.clear();
+    glyphs.clear();
+    glyph_offsets.clear();
     width = 0;
     x_position = 0;
     y_position = 0;
@@ -290,6 +376,7 @@ std::ostream& operator<<(std::ostream& os, const DisplayText& dt) {
 std::istream& operator>>(std::istream& stream, DisplayText& input) {
     try {
         stream >> input.text;
+        input.glyph_offsets.clear();
     } catch (const std::exception& e) {
         DEBUG_PRINT("Error in operator>> for DisplayText: " << e.what());
         throw std::runtime_error("Error in stream input: " + std::string(e.what()));
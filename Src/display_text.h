@@ -25,9 +25,12 @@
 #include <iomanip>
 #include <string>
 #include <array>
+#include <vector>
+#include <cstdint>
 #include <sstream>
 #include <stdexcept>
 #include <led-matrix.h>
+#include "glyph_atlas.h"
 
 using namespace rgb_matrix;
 
@@ -38,38 +41,68 @@ extern bool debug_mode;
 /**
  * FontCache - A utility class to cache character widths for faster text width calculations
  * This avoids repeated calls to Font::CharacterWidth which improves performance
+ *
+ * Text is UTF-8 (station names and messages can have accents, dashes and curly quotes). ASCII widths are
+ * held in a table; other characters are looked up in the glyph atlas, which never changes once loaded so
+ * the refresh worker and the render loop can both measure text without locking. Characters the font doesn't
+ * have are measured as they're drawn - as the replacement glyph, if the font has one
  */
 class FontCache {
 private:
-    std::array<int, 256> char_widths;
-    const Font* font_ptr = nullptr;
+    std::array<int, 128> ascii_widths;
+    const GlyphAtlas* atlas = nullptr;
     int baseline;
     int height;
+    int replacement_width = 0;                              // Width of U+FFFD - drawn for missing glyphs
     
 public:
     FontCache() = default;
+    FontCache(const FontCache&) = delete;
+    FontCache& operator=(const FontCache&) = delete;
+    
+    /**
+     * Decode the next character of UTF-8 text (as DrawText does)
+     * @param text The text
+     * @param i Index of the character's first byte - moved on past the character
+     * @return The Unicode code point
+     */
+    static uint32_t decodeUTF8(const std::string& text, size_t& i);
+    
+    /**
+     * The code point to draw for a character - punctuation the font doesn't have (curly quotes, en and em
+     * dashes, non-breaking spaces) is swapped for its ASCII equivalent
+     * @param codepoint Unicode code point
+     * @return The code point to draw
+     */
+    uint32_t normalise(uint32_t codepoint) const;
     
     /**
      * Set the font and cache all character widths
-     * @param font The font to use for width calculations
+     * @param font The glyph atlas of the font to use for width calculations
      */
-    void setFont(const Font& font);
+    void setFont(const GlyphAtlas& font);
     
     /**
      * Get the width of a single character
-     * @param c The character to get the width for
+     * @param c The character to get the width for (a byte of a multi-byte character measures 0)
      * @return The width of the character
-     * @throws std::out_of_range if the character is outside the cached range
      */
     int getCharWidth(char c) const;
     
     /**
-     * Calculate the width of a complete text string
+     * Calculate the width of a complete UTF-8 text string
      * @param text The text to calculate the width for
      * @return The total width of the text
      */
     int getTextWidth(const std::string& text) const;
     
+    /**
+     * Get the width of a glyph by its code point
+     * @param codepoint Unicode code point
+     * @return The width of the glyph (the replacement glyph's width if the font doesn't have it)
+     */
+    int getGlyphWidth(uint32_t codepoint) const;
+    
     /**
      * Return the font basline (x size)
      * @return The font baseline
@@ -96,6 +129,11 @@ public:
     int y_position = 0;
     uint64_t data_version = 0;
     
+    // The text's glyphs (decoded from UTF-8) and the x offset each starts at, with the total advance at the end.
+    // Built with the width - cleared whenever the text changes without it
+    std::vector<uint32_t> glyphs;
+    std::vector<int> glyph_offsets;
+    
     // Default constructor
     DisplayText() = default;
     
@@ -122,6 +160,20 @@ public:
      */
     void setWidth(const FontCache& fontsizes);
     
+    /**
+     * Draw only the glyphs that fall between clip_left and clip_right
+     * The first visible glyph is found with a binary search of glyph_offsets, so a long string costs no more
+     * than a short one. Without glyph offsets (the width hasn't been set) the whole text is drawn
+     * @param canvas Canvas to draw into
+     * @param font Font to draw with
+     * @param x X-position of the start of the text
+     * @param y Baseline
+     * @param color Colour of the text
+     * @param clip_left Leftmost column that will be shown
+     * @param clip_right One past the rightmost column that will be shown
+     */
+    void draw(Canvas* canvas, const GlyphAtlas& font, int x, int y, const Color& color, int clip_left, int clip_right) const;
+    
     /**
      * Return true if the string is empty
      * @return bool  - result of empty()
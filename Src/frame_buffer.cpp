@@ -0,0 +1,110 @@
+// Train Display - an RGB matrix departure board for the Raspberry Pi
+// Frame buffer
+// Version 1.0
+// Instructions, fixes and issues at https://github.com/jonmorrissmith/RGB_Matrix_Train_Departure_Board
+//
+#include "frame_buffer.h"
+#include <algorithm>
+#include <cstring>
+
+FrameBuffer::FrameBuffer(int w, int h)
+    : buffer_width(w > 0 ? w : 0),
+      buffer_height(h > 0 ? h : 0),
+      stride(static_cast<size_t>(buffer_width) * BYTES_PER_PIXEL),
+      pixels(stride * buffer_height, 0) {
+}
+
+void FrameBuffer::SetPixel(int x, int y, uint8_t red, uint8_t green, uint8_t blue) {
+    if (x < 0 || y < 0 || x >= buffer_width || y >= buffer_height) {
+        return;
+    }
+    uint8_t* pixel = &pixels[y * stride + static_cast<size_t>(x) * BYTES_PER_PIXEL];
+    pixel[0] = red;
+    pixel[1] = green;
+    pixel[2] = blue;
+}
+
+void FrameBuffer::Clear() {
+    std::memset(pixels.data(), 0, pixels.size());
+}
+
+void FrameBuffer::Fill(uint8_t red, uint8_t green, uint8_t blue) {
+    fillRect(Rect(0, 0, buffer_width, buffer_height), rgb_matrix::Color(red, green, blue));
+}
+
+void FrameBuffer::fillRect(const Rect& rect, const rgb_matrix::Color& color) {
+    Rect area = bounds(rect);
+    if (area.empty()) {
+        return;
+    }
+    size_t span = static_cast<size_t>(area.width) * BYTES_PER_PIXEL;
+    uint8_t* first_row = &pixels[area.y * stride + static_cast<size_t>(area.x) * BYTES_PER_PIXEL];
+
+    if (color.r == color.g && color.g == color.b) {
+        // Grey (and black) is the same byte throughout - a memset per row
+        for (int y = 0; y < area.height; y++) {
+            std::memset(first_row + y * stride, color.r, span);
+        }
+        return;
+    }
+    // Otherwise fill the first row a pixel at a time and copy it to the rest
+    for (int x = 0; x < area.width; x++) {
+        first_row[x * BYTES_PER_PIXEL] = color.r;
+        first_row[x * BYTES_PER_PIXEL + 1] = color.g;
+        first_row[x * BYTES_PER_PIXEL + 2] = color.b;
+    }
+    for (int y = 1; y < area.height; y++) {
+        std::memcpy(first_row + y * stride, first_row, span);
+    }
+}
+
+void FrameBuffer::serialize(const Rect& rect, std::vector<uint8_t>& out) const {
+    Rect area = bounds(rect);
+    size_t span = static_cast<size_t>(area.width) * BYTES_PER_PIXEL;
+    out.resize(area.empty() ? 0 : span * area.height);
+    for (int y = 0; y < area.height && !area.empty(); y++) {
+        std::memcpy(&out[y * span], &pixels[(area.y + y) * stride + static_cast<size_t>(area.x) * BYTES_PER_PIXEL], span);
+    }
+}
+
+bool FrameBuffer::deserialize(const Rect& rect, const std::vector<uint8_t>& in) {
+    Rect area = bounds(rect);
+    size_t span = static_cast<size_t>(area.width) * BYTES_PER_PIXEL;
+    if (area.empty() || in.size() != span * area.height) {
+        return false;
+    }
+    for (int y = 0; y < area.height; y++) {
+        std::memcpy(&pixels[(area.y + y) * stride + static_cast<size_t>(area.x) * BYTES_PER_PIXEL], &in[y * span], span);
+    }
+    return true;
+}
+
+bool FrameBuffer::deserializeRolled(const Rect& rect, const std::vector<uint8_t>& upper, const std::vector<uint8_t>& lower, int rows_up) {
+    Rect area = bounds(rect);
+    size_t span = static_cast<size_t>(area.width) * BYTES_PER_PIXEL;
+    if (area.empty() || upper.size() != span * area.height || lower.size() != span * area.height) {
+        return false;
+    }
+    rows_up = std::max(0, std::min(rows_up, area.height));
+    for (int y = 0; y < area.height; y++) {
+        int source_row = y + rows_up;
+        const uint8_t* source = (source_row < area.height) ? &upper[source_row * span] : &lower[(source_row - area.height) * span];
+        std::memcpy(&pixels[(area.y + y) * stride + static_cast<size_t>(area.x) * BYTES_PER_PIXEL], source, span);
+    }
+    return true;
+}
+
+uint64_t FrameBuffer::copyTo(rgb_matrix::Canvas* target, const Rect& rect) const {
+    Rect area = bounds(rect);
+    if (area.empty()) {
+        return 0;
+    }
+    // The matrix library only takes pixels one at a time, so this is the one per-pixel loop per frame
+    for (int y = area.y; y < area.y + area.height; y++) {
+        const uint8_t* pixel = &pixels[y * stride + static_cast<size_t>(area.x) * BYTES_PER_PIXEL];
+        for (int x = area.x; x < area.x + area.width; x++, pixel += BYTES_PER_PIXEL) {
+            target->SetPixel(x, y, pixel[0], pixel[1], pixel[2]);
+        }
+    }
+    return static_cast<uint64_t>(area.width) * area.height;
+}
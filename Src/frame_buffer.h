@@ -0,0 +1,86 @@
+// Train Display - an RGB matrix departure board for the Raspberry Pi
+// Frame buffer
+// Version 1.0
+// Instructions, fixes and issues at https://github.com/jonmorrissmith/RGB_Matrix_Train_Departure_Board
+//
+// The display's own image of the board - packed RGB, a row at a time - that the regions are drawn into.
+//
+// It persists from frame to frame, so it always holds the whole board as it should look. Clearing and
+// filling work on whole row spans with memset/memcpy rather than a SetPixel per pixel, and bringing a
+// matrix canvas up to date is a copy of the regions that canvas is missing.
+//
+#ifndef FRAME_BUFFER_H
+#define FRAME_BUFFER_H
+
+#include <canvas.h>
+#include <graphics.h>
+#include <cstdint>
+#include <vector>
+#include "damage_tracker.h"
+
+class FrameBuffer : public rgb_matrix::Canvas {
+public:
+    FrameBuffer(int w, int h);
+
+    int width() const override { return buffer_width; }
+    int height() const override { return buffer_height; }
+    void SetPixel(int x, int y, uint8_t red, uint8_t green, uint8_t blue) override;
+    void Clear() override;
+    void Fill(uint8_t red, uint8_t green, uint8_t blue) override;
+
+    /**
+     * Fill a rectangle (clipped to the buffer) - black is a memset per row
+     * @param rect The rectangle to fill
+     * @param color The colour to fill it with
+     */
+    void fillRect(const Rect& rect, const rgb_matrix::Color& color);
+
+    /**
+     * Copy a rectangle of the buffer to a canvas
+     * @param target The canvas to copy to (the same size as the buffer)
+     * @param rect The rectangle to copy
+     * @return The number of pixels copied
+     */
+    uint64_t copyTo(rgb_matrix::Canvas* target, const Rect& rect) const;
+
+    /**
+     * Save a rectangle of the buffer - its rows, packed one after another
+     * @param rect The rectangle to save (clipped to the buffer)
+     * @param out Replaced with the pixels
+     */
+    void serialize(const Rect& rect, std::vector<uint8_t>& out) const;
+
+    /**
+     * Put back a rectangle saved with serialize - a memcpy per row
+     * @param rect The rectangle it was saved from
+     * @param in The saved pixels
+     * @return false (and nothing is changed) if they aren't the size of the rectangle
+     */
+    bool deserialize(const Rect& rect, const std::vector<uint8_t>& in);
+
+    /**
+     * Put back a window onto two saved copies of a rectangle, one above the other - for rolling one
+     * row of text up into the place of another
+     * @param rect The rectangle they were saved from
+     * @param upper The saved pixels on top (rolling out)
+     * @param lower The saved pixels underneath (rolling in)
+     * @param rows_up How far the window has rolled - 0 shows all of upper, rect.height all of lower
+     * @return false (and nothing is changed) if they aren't the size of the rectangle
+     */
+    bool deserializeRolled(const Rect& rect, const std::vector<uint8_t>& upper, const std::vector<uint8_t>& lower, int rows_up);
+
+    // A row of pixels - width() RGB triples
+    const uint8_t* row(int y) const { return &pixels[y * stride]; }
+
+private:
+    static const int BYTES_PER_PIXEL = 3;
+
+    int buffer_width;
+    int buffer_height;
+    size_t stride;                                          // Bytes per row
+    std::vector<uint8_t> pixels;                            // RGB, row by row
+
+    Rect bounds(const Rect& rect) const { return rect.intersect(Rect(0, 0, buffer_width, buffer_height)); }
+};
+
+#endif // FRAME_BUFFER_H
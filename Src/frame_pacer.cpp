@@ -0,0 +1,180 @@
+// Train Display - an RGB matrix departure board for the Raspberry Pi
+// Frame pacer
+// Version 1.0
+// Instructions, fixes and issues at https://github.com/jonmorrissmith/RGB_Matrix_Train_Departure_Board
+//
+#include "frame_pacer.h"
+#include <algorithm>
+#include <iomanip>
+
+TimingHistogram::TimingHistogram() : samples(0), total_us(0), max_us(0) {
+    buckets.fill(0);
+}
+
+void TimingHistogram::record(std::chrono::steady_clock::duration duration) {
+    int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    if (us < 0) {
+        us = 0;
+    }
+    size_t bucket = static_cast<size_t>(us / 1000);
+    buckets[bucket < BUCKETS ? bucket : BUCKETS - 1]++;
+    samples++;
+    total_us += us;
+    if (us > max_us) {
+        max_us = us;
+    }
+}
+
+double TimingHistogram::percentile(double fraction) const {
+    uint64_t wanted = static_cast<uint64_t>(fraction * samples + 0.5);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= wanted && seen > 0) {
+            return static_cast<double>(i + 1);
+        }
+    }
+    return static_cast<double>(BUCKETS);
+}
+
+void TimingHistogram::write(std::ostream& out, const std::string& name) const {
+    out << std::fixed << std::setprecision(2) << name << ": count=" << samples;
+    if (samples == 0) {
+        out << std::endl;
+        return;
+    }
+    out << " mean_ms=" << (total_us / 1000.0) / samples
+        << " p50_ms<=" << percentile(0.50)
+        << " p90_ms<=" << percentile(0.90)
+        << " p99_ms<=" << percentile(0.99)
+        << " max_ms=" << max_us / 1000.0 << std::endl;
+
+    // Non-empty buckets as <lower edge in ms>:<count>
+    out << "  " << name << "_histogram:";
+    for (size_t i = 0; i < BUCKETS; i++) {
+        if (buckets[i]) {
+            out << " " << i << (i == BUCKETS - 1 ? "+" : "") << ":" << buckets[i];
+        }
+    }
+    out << std::endl;
+}
+
+FramePacer::FramePacer(int frames_per_second)
+    : target_fps(frames_per_second < 1 ? 1 : frames_per_second),
+      render_estimate(clock::duration::zero()),
+      have_anchor(false),
+      have_target(false),
+      previous_was_animation(false),
+      frame_count(0),
+      missed_frames(0),
+      skipped_frames(0) {
+    frame_period = std::chrono::duration_cast<clock::duration>(std::chrono::seconds(1)) / target_fps;
+}
+
+FramePacer::clock::time_point FramePacer::scheduleFrame(clock::time_point earliest) {
+    std::lock_guard<std::mutex> lock(mutex);
+    clock::time_point now = clock::now();
+    // The next frame is usually scheduled just before the frame that's due now is drawn - that one keeps its slot
+    claimDueTarget(now);
+    
+    // The first slot on the grid at or after 'earliest' and strictly after both the last slot drawn for and the
+    // frame on screen - the anchor only moves once a frame is on screen, so a slot drawn for may still be ahead
+    // of it. Before the first frame there's no grid and the slot is just 'earliest'
+    clock::time_point after = have_anchor ? std::max(drawn_slot, last_on_screen) : drawn_slot;
+    clock::time_point slot = std::max(earliest, after + frame_period / 2);
+    if (have_anchor) {
+        slot = last_on_screen + ((slot - last_on_screen + frame_period - clock::duration(1)) / frame_period) * frame_period;
+    }
+    target_slot = slot;
+    // Start in time for the slot, but not before 'earliest' - nothing would have moved, and the frame would only
+    // be scheduled for the same slot again. And never at or before now, however long frames take to render,
+    // or the display loop would handle the same event again without time moving on
+    target_wake = std::max(slot - render_estimate, earliest);
+    if (target_wake <= now) {
+        target_wake = now + clock::duration(1);
+    }
+    have_target = true;
+    return target_wake;
+}
+
+// Once its start time has come the scheduled frame is the one being drawn - it's measured against its slot
+void FramePacer::claimDueTarget(clock::time_point now) {
+    if (have_target && now >= target_wake) {
+        frame_ticket.slot = target_slot;
+        frame_ticket.is_target = true;
+        drawn_slot = target_slot;
+        have_target = false;
+    }
+}
+
+void FramePacer::frameStarted(clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex);
+    frame_start = now;
+    // Only the frame drawn for the slot is measured against it - not a clock or toggle frame drawn in between
+    claimDueTarget(now);
+}
+
+FramePacer::FrameTicket FramePacer::frameComposed(clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex);
+    clock::duration render = now - frame_start;
+    render_times.record(render);
+    render_estimate = (render_estimate * 7 + render) / 8;
+    FrameTicket ticket = frame_ticket;
+    frame_ticket.is_target = false;
+    return ticket;
+}
+
+void FramePacer::swapStarted(clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex);
+    swap_start = now;
+}
+
+void FramePacer::swapCompleted(clock::time_point now, const FrameTicket& ticket) {
+    std::lock_guard<std::mutex> lock(mutex);
+    swap_wait_times.record(now - swap_start);
+    frame_count++;
+
+    if (ticket.is_target) {
+        clock::duration lateness = now - ticket.slot;
+        if (lateness < clock::duration::zero()) {
+            lateness = clock::duration::zero();
+        }
+        lateness_times.record(lateness);
+        if (lateness >= frame_period) {
+            missed_frames += static_cast<uint64_t>(lateness / frame_period);
+        }
+        // Only consecutive animation frames make an interval
+        if (previous_was_animation && ticket.slot - previous_slot <= frame_period + frame_period / 2) {
+            interval_times.record(now - last_on_screen);
+        }
+        previous_slot = ticket.slot;
+        previous_was_animation = true;
+    } else {
+        previous_was_animation = false;
+    }
+
+    last_on_screen = now;
+    have_anchor = true;
+}
+
+void FramePacer::frameSkipped(clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex);
+    skipped_frames++;
+    // The slot it was scheduled for has gone - don't measure the next frame against it
+    claimDueTarget(now);
+    frame_ticket.is_target = false;
+}
+
+void FramePacer::writeReport(std::ostream& out) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    out << "target_fps=" << target_fps
+        << " period_ms=" << std::fixed << std::setprecision(2)
+        << std::chrono::duration_cast<std::chrono::microseconds>(frame_period).count() / 1000.0
+        << " frames=" << frame_count
+        << " missed_frames=" << missed_frames
+        << " skipped_frames=" << skipped_frames << std::endl;
+    interval_times.write(out, "interval");
+    render_times.write(out, "render");
+    swap_wait_times.write(out, "swap_wait");
+    lateness_times.write(out, "lateness");
+}
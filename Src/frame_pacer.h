@@ -0,0 +1,144 @@
+// Train Display - an RGB matrix departure board for the Raspberry Pi
+// Frame pacer
+// Version 1.0
+// Instructions, fixes and issues at https://github.com/jonmorrissmith/RGB_Matrix_Train_Departure_Board
+//
+// Keeps animation frames on a steady grid at the target frame rate and measures how well that works.
+//
+// The grid is anchored to the moment the last frame went on screen (when SwapOnVSync returned), so frames
+// stay in step with the panel refresh rather than drifting against it. The display wakes a little before
+// each grid slot - by the recent render time - so the swap lands on the slot.
+//
+// For every frame it records:
+//   interval    time between consecutive animation frames going on screen
+//   render      time spent drawing the frame
+//   swap_wait   time spent in SwapOnVSync waiting for the panel
+//   lateness    how long after its grid slot an animation frame went on screen
+// A frame that goes on screen a whole period or more after its slot is counted as missed. A frame that
+// wasn't drawn because nothing had changed is counted as skipped.
+//
+// A frame can be swapped on another thread from the one that drew it (see frame_presenter.h) - what it's
+// measured against travels with it as a FrameTicket, and the pacer is safe to call from both threads.
+//
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+// Distribution of a set of timings, in 1ms buckets up to TimingHistogram::BUCKETS ms
+class TimingHistogram {
+public:
+    static const size_t BUCKETS = 100;                      // The last bucket holds everything longer
+
+    TimingHistogram();
+    void record(std::chrono::steady_clock::duration duration);
+    uint64_t count() const { return samples; }
+
+    /**
+     * Write a summary line and the non-empty buckets
+     * @param out The stream to write to
+     * @param name Name of the timing
+     */
+    void write(std::ostream& out, const std::string& name) const;
+
+private:
+    std::array<uint64_t, BUCKETS> buckets;
+    uint64_t samples;
+    int64_t total_us;
+    int64_t max_us;
+
+    double percentile(double fraction) const;               // Upper edge of the bucket (ms)
+};
+
+class FramePacer {
+public:
+    typedef std::chrono::steady_clock clock;
+
+    // What a drawn frame is measured against when it goes on screen
+    struct FrameTicket {
+        clock::time_point slot;                             // Its grid slot
+        bool is_target = false;                             // Is it an animation frame (drawn for the slot)
+    };
+
+    /**
+     * @param frames_per_second Target frame rate for animation (anything under 1 is treated as 1)
+     */
+    explicit FramePacer(int frames_per_second);
+
+    clock::duration period() const { return frame_period; }
+
+    /**
+     * Choose the grid slot for the next animation frame, no earlier than 'earliest'
+     * The next frame drawn is measured against this slot
+     * @param earliest The soonest the frame is wanted on screen
+     * @return When to start drawing the frame - the slot less the expected render time, but not before 'earliest'
+     *         and always later than now (so a caller that sleeps until then always sleeps)
+     */
+    clock::time_point scheduleFrame(clock::time_point earliest);
+
+    // Call at the start of drawing a frame
+    void frameStarted(clock::time_point now);
+
+    /**
+     * The frame has been drawn - records the render time
+     * @param now The time drawing finished
+     * @return The ticket to pass to swapCompleted when the frame goes on screen
+     */
+    FrameTicket frameComposed(clock::time_point now);
+
+    // Call just before SwapOnVSync and just after it returns
+    void swapStarted(clock::time_point now);
+    void swapCompleted(clock::time_point now, const FrameTicket& ticket);
+
+    /**
+     * A frame was due but nothing on it had changed, so it wasn't drawn
+     * @param now The time it was due
+     */
+    void frameSkipped(clock::time_point now);
+
+    uint64_t frames() const { std::lock_guard<std::mutex> lock(mutex); return frame_count; }
+    uint64_t missedFrames() const { std::lock_guard<std::mutex> lock(mutex); return missed_frames; }
+    uint64_t skippedFrames() const { std::lock_guard<std::mutex> lock(mutex); return skipped_frames; }
+
+    /**
+     * Write the frame statistics since start-up
+     * @param out The stream to write to
+     */
+    void writeReport(std::ostream& out) const;
+
+private:
+    mutable std::mutex mutex;                               // Frames can be swapped on another thread
+    clock::duration frame_period;
+    int target_fps;
+    clock::duration render_estimate;                        // Smoothed render time - how early to start a frame
+
+    clock::time_point frame_start;
+    clock::time_point swap_start;
+    clock::time_point last_on_screen;                       // Grid anchor
+    bool have_anchor;
+    clock::time_point target_slot;                          // Slot of the next animation frame
+    clock::time_point target_wake;                          // When drawing it was scheduled to start
+    bool have_target;
+    FrameTicket frame_ticket;                               // Slot of the frame due or being drawn, if it's an animation frame
+    clock::time_point drawn_slot;                           // Slot of the last animation frame due (it may not be on screen yet)
+                                                            // - the clock's epoch until then, before any slot
+    clock::time_point previous_slot;                        // Slot of the last animation frame
+    bool previous_was_animation;
+
+    void claimDueTarget(clock::time_point now);             // The scheduled frame becomes the frame being drawn once it's due
+
+    uint64_t frame_count;
+    uint64_t missed_frames;
+    uint64_t skipped_frames;
+    TimingHistogram interval_times;
+    TimingHistogram render_times;
+    TimingHistogram swap_wait_times;
+    TimingHistogram lateness_times;
+};
+
+#endif // FRAME_PACER_H
@@ -0,0 +1,213 @@
+// Train Display - an RGB matrix departure board for the Raspberry Pi
+// Frame presenter
+// Version 1.0
+// Instructions, fixes and issues at https://github.com/jonmorrissmith/RGB_Matrix_Train_Departure_Board
+//
+#include "frame_presenter.h"
+#include <algorithm>
+#include <iomanip>
+
+const int FramePresenter::MAX_DEPTH;
+const size_t FramePresenter::MAX_STALE_RECTS;
+
+FramePresenter::FramePresenter(DisplayBackend& display, FramePacer& pacer, int depth)
+    : backend(display),
+      frame_pacer(pacer),
+      screen(0, 0, display.width(), display.height()),
+      schedule(nullptr),
+      head(0),
+      count(0),
+      presenting(false),
+      stopping(false),
+      back(0),
+      submitted(0),
+      replaced(0),
+      dropped(0),
+      shown(0),
+      total_pixels(0),
+      max_waiting(0) {
+    depth = std::max(1, std::min(depth, MAX_DEPTH));
+    ring.resize(static_cast<size_t>(depth) + 1);
+    for (Slot& slot : ring) {
+        slot.frame.reset(new FrameBuffer(screen.width, screen.height));
+    }
+    // Neither canvas has anything on it yet
+    for (int i = 0; i < DamageTracker::CANVASES; i++) {
+        stale[i].push_back(screen);
+    }
+}
+
+FramePresenter::~FramePresenter() {
+    stop();
+}
+
+void FramePresenter::start(ThreadSchedule* thread_schedule) {
+    if (presenter.joinable()) {
+        return;
+    }
+    schedule = thread_schedule;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = false;
+    }
+    presenter = std::thread(&FramePresenter::run, this);
+}
+
+void FramePresenter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    frame_ready.notify_one();
+    if (presenter.joinable()) {
+        presenter.join();
+    }
+}
+
+void FramePresenter::submit(const FrameBuffer& frame, const std::vector<Rect>& changed, const FramePacer::FrameTicket& ticket) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        submitted++;
+        if (count < ring.size()) {
+            Slot& slot = ring[(head + count) % ring.size()];
+            *slot.frame = frame;
+            slot.changed = changed;
+            slot.ticket = ticket;
+            slot.handed_over = std::chrono::steady_clock::now();
+            count++;
+        } else {
+            // Full - the head is being shown or about to be, so replace the newest frame waiting. Its changes
+            // still have to reach the canvases, and an animation frame stays measured against its slot
+            Slot& slot = ring[(head + count - 1) % ring.size()];
+            *slot.frame = frame;
+            slot.changed.insert(slot.changed.end(), changed.begin(), changed.end());
+            if (ticket.is_target || !slot.ticket.is_target) {
+                slot.ticket = ticket;
+            }
+            replaced++;
+        }
+        uint64_t waiting = count - (presenting ? 1 : 0);
+        max_waiting = std::max(max_waiting, waiting);
+    }
+    frame_ready.notify_one();
+}
+
+void FramePresenter::run() {
+    if (schedule) {
+        schedule->apply();
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        // Woken with a frame - how long that took is the thread's wake latency
+        if (count == 0) {
+            frame_ready.wait(lock, [this] { return stopping || count > 0; });
+            if (schedule && count > 0) {
+                schedule->recordWake(std::chrono::steady_clock::now() - ring[head].handed_over);
+            }
+        }
+        if (stopping) {
+            break;
+        }
+
+        // A frame drawn ahead waits for its slot. Of those that are due only the newest is shown - the
+        // others are dropped, so a backlog never builds up behind the screen
+        auto now = std::chrono::steady_clock::now();
+        auto half_period = frame_pacer.period() / 2;
+        auto due = [&](const Slot& slot) { return !slot.ticket.is_target || slot.ticket.slot <= now + half_period; };
+        if (!due(ring[head])) {
+            auto wake_at = ring[head].ticket.slot - half_period;
+            if (frame_ready.wait_until(lock, wake_at) == std::cv_status::timeout && schedule) {
+                schedule->recordWake(std::chrono::steady_clock::now() - wake_at);
+            }
+            continue;
+        }
+        size_t newest = 0;
+        while (newest + 1 < count && due(ring[(head + newest + 1) % ring.size()])) {
+            newest++;
+        }
+        for (size_t i = 0; i <= newest; i++) {
+            for (const Rect& rect : ring[(head + i) % ring.size()].changed) {
+                for (int canvas = 0; canvas < DamageTracker::CANVASES; canvas++) {
+                    addStale(stale[canvas], rect, screen);
+                }
+            }
+        }
+        head = (head + newest) % ring.size();
+        count -= newest;
+        dropped += newest;
+
+        Slot& slot = ring[head];
+        presenting = true;
+        lock.unlock();
+
+        uint64_t pixels = 0;
+        {
+            std::lock_guard<std::mutex> backend_lock(backend_mutex);
+            // Bring the canvas being drawn up to date - the other one catches up with the next frame
+            rgb_matrix::Canvas* canvas = backend.canvas();
+            for (const Rect& rect : stale[back]) {
+                pixels += slot.frame->copyTo(canvas, rect);
+            }
+            stale[back].clear();
+
+            frame_pacer.swapStarted(std::chrono::steady_clock::now());
+            backend.swap();
+            frame_pacer.swapCompleted(std::chrono::steady_clock::now(), slot.ticket);
+            back = (back + 1) % DamageTracker::CANVASES;
+        }
+
+        lock.lock();
+        presenting = false;
+        head = (head + 1) % ring.size();
+        count--;
+        shown++;
+        total_pixels += pixels;
+    }
+    lock.unlock();
+    if (schedule) {
+        schedule->finished();
+    }
+}
+
+// Add a rectangle to a canvas's stale list - one already covered is left out, and a list that's grown too long
+// (the clock's rectangle moves, for one) becomes the whole screen
+void FramePresenter::addStale(std::vector<Rect>& rects, const Rect& rect, const Rect& screen) {
+    Rect clipped = rect.intersect(screen);
+    if (clipped.empty()) {
+        return;
+    }
+    auto covers = [](const Rect& outer, const Rect& inner) {
+        return inner.x >= outer.x && inner.y >= outer.y &&
+               inner.x + inner.width <= outer.x + outer.width && inner.y + inner.height <= outer.y + outer.height;
+    };
+    for (const Rect& existing : rects) {
+        if (covers(existing, clipped)) {
+            return;
+        }
+    }
+    rects.erase(std::remove_if(rects.begin(), rects.end(),
+                               [&](const Rect& existing) { return covers(clipped, existing); }),
+                rects.end());
+    if (rects.size() >= MAX_STALE_RECTS) {
+        rects.assign(1, screen);
+    } else {
+        rects.push_back(clipped);
+    }
+}
+
+void FramePresenter::writeReport(std::ostream& out) const {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        out << "presenter: depth=" << ring.size() - 1
+            << " submitted=" << submitted
+            << " shown=" << shown
+            << " replaced=" << replaced
+            << " dropped=" << dropped
+            << " max_waiting=" << max_waiting
+            << " pixel_writes_total=" << total_pixels
+            << " mean_pixel_writes=" << std::fixed << std::setprecision(1)
+            << (shown ? static_cast<double>(total_pixels) / shown : 0.0) << std::endl;
+    }
+    std::lock_guard<std::mutex> backend_lock(backend_mutex);
+    backend.writeReport(out);
+}
@@ -0,0 +1,119 @@
+// Train Display - an RGB matrix departure board for the Raspberry Pi
+// Frame presenter
+// Version 1.0
+// Instructions, fixes and issues at https://github.com/jonmorrissmith/RGB_Matrix_Train_Departure_Board
+//
+// Shows frames on a thread of its own, so the render loop can compose the next frame while the current
+// one is waiting for SwapOnVSync.
+//
+// The render loop hands over each finished frame buffer with the rectangles that changed in it. It's
+// copied into a small ring of frames; the presenter thread takes them in order, copies into the backend's
+// canvas whatever that canvas is missing (it holds the frame from two swaps ago, as in damage_tracker.h)
+// and swaps. A scroll frame drawn ahead of its slot on the frame pacer's grid waits for it; if several
+// frames are due, the older ones are dropped and their changes carried over to the newest.
+//
+// Handing a frame over never waits for a swap - if the ring is full (a swap has stalled), the newest frame
+// waiting is replaced instead.
+//
+// While the presenter is running it owns the backend - nothing else may draw into it or swap it.
+//
+#ifndef FRAME_PRESENTER_H
+#define FRAME_PRESENTER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+#include "damage_tracker.h"
+#include "display_backend.h"
+#include "frame_buffer.h"
+#include "frame_pacer.h"
+#include "thread_schedule.h"
+
+class FramePresenter {
+public:
+    static const int MAX_DEPTH = 4;
+
+    /**
+     * @param display The backend to show frames on
+     * @param pacer Measures each frame as it goes on screen
+     * @param depth Frames that can wait to be shown, 1 to MAX_DEPTH
+     */
+    FramePresenter(DisplayBackend& display, FramePacer& pacer, int depth);
+    ~FramePresenter();
+
+    FramePresenter(const FramePresenter&) = delete;
+    FramePresenter& operator=(const FramePresenter&) = delete;
+
+    /**
+     * Start the presenter thread
+     * @param thread_schedule Scheduling for the thread, applied by the thread itself (nullptr to leave it alone)
+     */
+    void start(ThreadSchedule* thread_schedule = nullptr);
+
+    /**
+     * Stop the presenter thread and wait for it - frames still waiting aren't shown
+     * Safe to call more than once
+     */
+    void stop();
+
+    /**
+     * Hand over a finished frame - it's copied, so the frame buffer can be drawn into straight away
+     * @param frame The frame
+     * @param changed The rectangles that changed since the last frame handed over
+     * @param ticket What the frame is measured against (from FramePacer::frameComposed)
+     */
+    void submit(const FrameBuffer& frame, const std::vector<Rect>& changed, const FramePacer::FrameTicket& ticket);
+
+    /**
+     * Write the presenter statistics, and the backend's
+     * @param out The stream to write to
+     */
+    void writeReport(std::ostream& out) const;
+
+private:
+    // A stale canvas with more separate rectangles than this is copied whole
+    static const size_t MAX_STALE_RECTS = 16;
+
+    struct Slot {
+        std::unique_ptr<FrameBuffer> frame;
+        std::vector<Rect> changed;
+        FramePacer::FrameTicket ticket;
+        std::chrono::steady_clock::time_point handed_over;
+    };
+
+    DisplayBackend& backend;
+    FramePacer& frame_pacer;
+    Rect screen;
+
+    std::thread presenter;
+    ThreadSchedule* schedule;
+    mutable std::mutex mutex;                               // Guards the ring and stopping
+    std::condition_variable frame_ready;
+    std::vector<Slot> ring;                                 // One being shown plus those waiting
+    size_t head;                                            // The oldest frame in the ring
+    size_t count;                                           // Frames in the ring
+    bool presenting;                                        // Is the head frame being shown
+    bool stopping;
+
+    // Only touched on the presenter thread - and the backend under backend_mutex, for its report
+    mutable std::mutex backend_mutex;
+    std::vector<Rect> stale[DamageTracker::CANVASES];       // What each canvas is missing
+    int back;                                               // Index of the canvas being drawn
+
+    // Statistics (guarded by mutex)
+    uint64_t submitted;
+    uint64_t replaced;                                      // Frames replaced while the ring was full
+    uint64_t dropped;                                       // Frames not shown because a newer one was due
+    uint64_t shown;
+    uint64_t total_pixels;
+    uint64_t max_waiting;
+
+    void run();
+    static void addStale(std::vector<Rect>& rects, const Rect& rect, const Rect& screen);
+};
+
+#endif // FRAME_PRESENTER_H
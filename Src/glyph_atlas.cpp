@@ -0,0 +1,383 @@
+// Train Display - an RGB matrix departure board for the Raspberry Pi
+// Glyph atlas
+// Version 1.0
+// Instructions, fixes and issues at https://github.com/jonmorrissmith/RGB_Matrix_Train_Departure_Board
+//
+#include "glyph_atlas.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char MAGIC[8] = {'T', 'D', 'A', 'T', 'L', 'A', 'S', '\0'};
+
+// A canvas that records where a glyph sets pixels - any coordinates, including negative ones
+class RecordingCanvas : public rgb_matrix::Canvas {
+public:
+    std::vector<std::pair<int, int> > pixels;
+
+    int width() const override { return 1 << 16; }
+    int height() const override { return 1 << 16; }
+    void SetPixel(int x, int y, uint8_t red, uint8_t green, uint8_t blue) override {
+        if (red | green | blue) {
+            pixels.push_back(std::make_pair(x, y));
+        }
+    }
+    void Clear() override { pixels.clear(); }
+    void Fill(uint8_t red, uint8_t green, uint8_t blue) override { (void)red; (void)green; (void)blue; }
+};
+
+// The code points a BDF font has - from its ENCODING lines
+std::vector<uint32_t> fontCodepoints(const std::string& font_path) {
+    std::vector<uint32_t> codepoints;
+    std::ifstream in(font_path);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.compare(0, 9, "ENCODING ") == 0) {
+            long codepoint = std::strtol(line.c_str() + 9, nullptr, 10);
+            if (codepoint >= 0) {
+                codepoints.push_back(static_cast<uint32_t>(codepoint));
+            }
+        }
+    }
+    return codepoints;
+}
+
+} // namespace
+
+GlyphAtlas::GlyphAtlas()
+    : glyph_table(nullptr),
+      words(nullptr),
+      glyph_count(0),
+      word_count(0),
+      font_height(0),
+      font_baseline(0),
+      replacement_index(-1),
+      mapped(nullptr),
+      mapped_size(0) {
+    ascii_index.fill(-1);
+}
+
+GlyphAtlas::~GlyphAtlas() {
+    unmap();
+}
+
+void GlyphAtlas::unmap() {
+    if (mapped) {
+        munmap(mapped, mapped_size);
+        mapped = nullptr;
+        mapped_size = 0;
+    }
+}
+
+void GlyphAtlas::open(const std::string& font_path, const std::string& cache_path) {
+    if (!cache_path.empty() && load(cache_path, font_path)) {
+        return;
+    }
+
+    rgb_matrix::Font font;
+    if (!font.LoadFont(font_path.c_str())) {
+        throw std::runtime_error("Font loading failed for: " + font_path);
+    }
+    build(font, fontCodepoints(font_path));
+    if (empty()) {
+        throw std::runtime_error("Font has no glyphs: " + font_path);
+    }
+
+    if (!cache_path.empty()) {
+        try {
+            save(cache_path, font_path);
+        } catch (const std::exception& e) {
+            // The display works without the cache - it's just slower to start
+            std::cerr << "Font cache not saved: " << e.what() << std::endl;
+        }
+    }
+}
+
+void GlyphAtlas::build(const rgb_matrix::Font& font, const std::vector<uint32_t>& codepoints) {
+    unmap();
+    built_glyphs.clear();
+    built_words.clear();
+    font_height = font.height();
+    font_baseline = font.baseline();
+
+    std::vector<uint32_t> sorted(codepoints);
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    RecordingCanvas canvas;
+    for (uint32_t codepoint : sorted) {
+        int advance = font.CharacterWidth(codepoint);
+        if (advance < 0) {
+            continue;
+        }
+        // Draw the glyph with the pen at the top-left of the font and see where it lands
+        canvas.Clear();
+        font.DrawGlyph(&canvas, 0, font_baseline, rgb_matrix::Color(255, 255, 255), codepoint);
+
+        Glyph glyph;
+        std::memset(&glyph, 0, sizeof(glyph));
+        glyph.codepoint = codepoint;
+        glyph.advance = static_cast<int16_t>(advance);
+        glyph.first_word = static_cast<uint32_t>(built_words.size());
+        if (!canvas.pixels.empty()) {
+            int left = canvas.pixels[0].first, right = left;
+            int top = canvas.pixels[0].second, bottom = top;
+            for (const auto& pixel : canvas.pixels) {
+                left = std::min(left, pixel.first);
+                right = std::max(right, pixel.first);
+                top = std::min(top, pixel.second);
+                bottom = std::max(bottom, pixel.second);
+            }
+            glyph.left = static_cast<int16_t>(left);
+            glyph.top = static_cast<int16_t>(top);
+            glyph.width = static_cast<uint8_t>(std::min(right - left + 1, 255));
+            glyph.height = static_cast<uint8_t>(std::min(bottom - top + 1, 255));
+            glyph.words_per_row = static_cast<uint16_t>((glyph.width + 31) / 32);
+            built_words.resize(built_words.size() + static_cast<size_t>(glyph.words_per_row) * glyph.height, 0);
+            for (const auto& pixel : canvas.pixels) {
+                int column = pixel.first - left;
+                int row = pixel.second - top;
+                if (column < glyph.width && row < glyph.height) {
+                    built_words[glyph.first_word + static_cast<size_t>(row) * glyph.words_per_row + (column >> 5)] |= 1u << (column & 31);
+                }
+            }
+        }
+        built_glyphs.push_back(glyph);
+    }
+
+    glyph_table = built_glyphs.data();
+    glyph_count = built_glyphs.size();
+    words = built_words.data();
+    word_count = built_words.size();
+    index();
+}
+
+void GlyphAtlas::save(const std::string& path, const std::string& font_path) const {
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    header.glyph_count = static_cast<uint32_t>(glyph_count);
+    if (!fontIdentity(font_path, header.font_size, header.font_mtime, header.font_path_hash)) {
+        throw std::runtime_error("Cannot read " + font_path);
+    }
+    header.height = font_height;
+    header.baseline = font_baseline;
+    header.word_count = static_cast<uint32_t>(word_count);
+
+    // Written alongside and renamed into place, so a half-written file is never loaded
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("Cannot write " + temporary);
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(glyph_table), static_cast<std::streamsize>(glyph_count * sizeof(Glyph)));
+        out.write(reinterpret_cast<const char*>(words), static_cast<std::streamsize>(word_count * sizeof(uint32_t)));
+        if (!out) {
+            throw std::runtime_error("Error writing " + temporary);
+        }
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("Cannot replace " + path);
+    }
+}
+
+bool GlyphAtlas::load(const std::string& path, const std::string& font_path) {
+    uint64_t size;
+    int64_t mtime;
+    uint64_t path_hash;
+    if (!fontIdentity(font_path, size, mtime, path_hash)) {
+        return false;
+    }
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(Header)) {
+        data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    size_t file_size = static_cast<size_t>(st.st_size);
+
+    // Only use it if it was built by this version from this font, and it's all there
+    const Header* header = static_cast<const Header*>(data);
+    const Glyph* table = reinterpret_cast<const Glyph*>(static_cast<const char*>(data) + sizeof(Header));
+    bool valid = std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0 &&
+                 header->version == VERSION &&
+                 header->font_size == size && header->font_mtime == mtime && header->font_path_hash == path_hash &&
+                 header->glyph_count > 0 &&
+                 file_size == sizeof(Header) + static_cast<uint64_t>(header->glyph_count) * sizeof(Glyph) +
+                              static_cast<uint64_t>(header->word_count) * sizeof(uint32_t);
+    for (uint32_t i = 0; valid && i < header->glyph_count; i++) {
+        valid = table[i].first_word + static_cast<size_t>(table[i].words_per_row) * table[i].height <= header->word_count &&
+                table[i].words_per_row == (table[i].width + 31) / 32 &&
+                (i == 0 || table[i - 1].codepoint < table[i].codepoint);
+    }
+    if (!valid) {
+        munmap(data, file_size);
+        return false;
+    }
+
+    unmap();
+    built_glyphs.clear();
+    built_words.clear();
+    mapped = data;
+    mapped_size = file_size;
+    glyph_table = table;
+    glyph_count = header->glyph_count;
+    words = reinterpret_cast<const uint32_t*>(table + glyph_count);
+    word_count = header->word_count;
+    font_height = header->height;
+    font_baseline = header->baseline;
+    index();
+    return true;
+}
+
+void GlyphAtlas::index() {
+    ascii_index.fill(-1);
+    for (size_t i = 0; i < glyph_count && glyph_table[i].codepoint < 128; i++) {
+        ascii_index[glyph_table[i].codepoint] = static_cast<int16_t>(i);
+    }
+    const Glyph* replacement = find(0xFFFD);
+    replacement_index = replacement ? static_cast<int>(replacement - glyph_table) : -1;
+}
+
+const GlyphAtlas::Glyph* GlyphAtlas::find(uint32_t codepoint) const {
+    if (codepoint < 128) {
+        return ascii_index[codepoint] < 0 ? nullptr : &glyph_table[ascii_index[codepoint]];
+    }
+    const Glyph* end = glyph_table + glyph_count;
+    const Glyph* found = std::lower_bound(glyph_table, end, codepoint,
+                                          [](const Glyph& glyph, uint32_t value) { return glyph.codepoint < value; });
+    return (found != end && found->codepoint == codepoint) ? found : nullptr;
+}
+
+const GlyphAtlas::Glyph* GlyphAtlas::findOrReplacement(uint32_t codepoint) const {
+    const Glyph* glyph = find(codepoint);
+    if (!glyph && replacement_index >= 0) {
+        glyph = &glyph_table[replacement_index];
+    }
+    return glyph;
+}
+
+int GlyphAtlas::characterWidth(uint32_t codepoint) const {
+    const Glyph* glyph = find(codepoint);
+    return glyph ? glyph->advance : -1;
+}
+
+int GlyphAtlas::drawGlyph(rgb_matrix::Canvas* target, int x, int y, const rgb_matrix::Color& color, uint32_t codepoint,
+                          int clip_left, int clip_right) const {
+    const Glyph* glyph = findOrReplacement(codepoint);
+    if (!glyph) {
+        return 0;
+    }
+    int glyph_x = x + glyph->left;
+    int glyph_y = y - font_baseline + glyph->top;
+    // Columns of the glyph inside the clip
+    int first_column = std::max(0, clip_left - glyph_x);
+    int end_column = std::min<int>(glyph->width, clip_right - glyph_x);
+    if (first_column >= end_column) {
+        return glyph->advance;
+    }
+
+    const uint32_t* row = words + glyph->first_word;
+    for (int r = 0; r < glyph->height; r++, row += glyph->words_per_row) {
+        for (int w = first_column >> 5; w <= (end_column - 1) >> 5; w++) {
+            uint32_t bits = row[w];
+            // Mask off the columns outside the clip
+            int low = first_column - w * 32;
+            int high = end_column - w * 32;
+            if (low > 0) {
+                bits &= ~0u << low;
+            }
+            if (high < 32) {
+                bits &= (1u << high) - 1;
+            }
+            while (bits) {
+                int bit = __builtin_ctz(bits);
+                bits &= bits - 1;
+                target->SetPixel(glyph_x + w * 32 + bit, glyph_y + r, color.r, color.g, color.b);
+            }
+        }
+    }
+    return glyph->advance;
+}
+
+int GlyphAtlas::blitGlyph(uint32_t* bits, int words_per_row, int bitmap_width, int bitmap_height, int x, int y, uint32_t codepoint) const {
+    const Glyph* glyph = findOrReplacement(codepoint);
+    if (!glyph) {
+        return 0;
+    }
+    int glyph_x = x + glyph->left;
+    int glyph_y = y - font_baseline + glyph->top;
+
+    const uint32_t* row = words + glyph->first_word;
+    for (int r = 0; r < glyph->height; r++, row += glyph->words_per_row) {
+        int target_y = glyph_y + r;
+        if (target_y < 0 || target_y >= bitmap_height) {
+            continue;
+        }
+        uint32_t* target = bits + static_cast<size_t>(target_y) * words_per_row;
+        for (int w = 0; w < glyph->words_per_row; w++) {
+            uint32_t word = row[w];
+            int column = glyph_x + w * 32;
+            // Trim the word to the bitmap, then OR it in across (at most) two words
+            if (column < 0) {
+                if (column <= -32) {
+                    continue;
+                }
+                word >>= -column;
+                column = 0;
+            }
+            int room = bitmap_width - column;
+            if (room <= 0 || word == 0) {
+                continue;
+            }
+            if (room < 32) {
+                word &= (1u << room) - 1;
+            }
+            int index = column >> 5;
+            int shift = column & 31;
+            target[index] |= word << shift;
+            if (shift && index + 1 < words_per_row) {
+                target[index + 1] |= word >> (32 - shift);
+            }
+        }
+    }
+    return glyph->advance;
+}
+
+bool GlyphAtlas::fontIdentity(const std::string& font_path, uint64_t& size, int64_t& mtime, uint64_t& path_hash) {
+    struct stat st;
+    if (stat(font_path.c_str(), &st) != 0) {
+        return false;
+    }
+    size = static_cast<uint64_t>(st.st_size);
+    mtime = static_cast<int64_t>(st.st_mtime);
+    // FNV-1a
+    path_hash = 14695981039346656037ull;
+    for (unsigned char c : font_path) {
+        path_hash = (path_hash ^ c) * 1099511628211ull;
+    }
+    return true;
+}
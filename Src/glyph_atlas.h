@@ -0,0 +1,161 @@
+// Train Display - an RGB matrix departure board for the Raspberry Pi
+// Glyph atlas
+// Version 1.0
+// Instructions, fixes and issues at https://github.com/jonmorrissmith/RGB_Matrix_Train_Departure_Board
+//
+// The font as packed 1-bit glyph bitmaps - what the display measures and draws text with.
+//
+// Loading a BDF font means parsing a text file of hex bitmaps, and drawing a glyph through the matrix
+// library tests every bit of its bounding box. The atlas is built from the font once - each glyph is drawn
+// through Font::DrawGlyph and its set pixels packed into rows of 32-bit words, trimmed to the pixels
+// actually set - and saved to a cache file. Later starts map the cache file straight into memory.
+//
+// Drawing walks the set bits of each row a word at a time, skipping empty rows and words, and rendering
+// into a 1-bit strip (see text_strip.h) ORs whole shifted words in.
+//
+// Cache file (native byte order - it's only read on the machine that wrote it):
+//   Header            magic, version, the font's size, modification time and path hash, metrics, counts
+//   Glyph[count]      sorted by code point
+//   uint32_t[words]   glyph rows - bit n of a word is column n of the row
+//
+#ifndef GLYPH_ATLAS_H
+#define GLYPH_ATLAS_H
+
+#include <graphics.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class GlyphAtlas {
+public:
+    GlyphAtlas();
+    ~GlyphAtlas();
+    GlyphAtlas(const GlyphAtlas&) = delete;
+    GlyphAtlas& operator=(const GlyphAtlas&) = delete;
+
+    /**
+     * Load the atlas for a BDF font - from the cache file if it was built from this font, otherwise from
+     * the font itself (and the cache file is written for next time)
+     * @param font_path The BDF font
+     * @param cache_path The cache file - empty to always build from the font
+     * @throws std::runtime_error if the font can't be loaded
+     */
+    void open(const std::string& font_path, const std::string& cache_path);
+
+    /**
+     * Build the atlas from a loaded font
+     * @param font The font
+     * @param codepoints The code points to include (those missing from the font are skipped)
+     */
+    void build(const rgb_matrix::Font& font, const std::vector<uint32_t>& codepoints);
+
+    /**
+     * Save the atlas
+     * @param path The file to write
+     * @param font_path The font it was built from (recorded so a changed font isn't used from the cache)
+     * @throws std::runtime_error if the file can't be written
+     */
+    void save(const std::string& path, const std::string& font_path) const;
+
+    /**
+     * Map a saved atlas into memory
+     * @param path The cache file
+     * @param font_path The font it must have been built from
+     * @return false if there's no cache file or it's not for this font (or this version)
+     */
+    bool load(const std::string& path, const std::string& font_path);
+
+    bool empty() const { return glyph_count == 0; }
+    int height() const { return font_height; }
+    int baseline() const { return font_baseline; }
+    size_t glyphs() const { return glyph_count; }
+    bool fromCache() const { return mapped != nullptr; }
+
+    /**
+     * Advance width of a character
+     * @param codepoint Unicode code point
+     * @return The width, or -1 if the font doesn't have the character
+     */
+    int characterWidth(uint32_t codepoint) const;
+
+    /**
+     * Draw a character (the replacement character U+FFFD if the font doesn't have it)
+     * @param target Canvas to draw into
+     * @param x Left of the character
+     * @param y Baseline
+     * @param color Colour of the character
+     * @param codepoint Unicode code point
+     * @param clip_left Leftmost column to draw
+     * @param clip_right One past the rightmost column to draw
+     * @return The advance width (0 if nothing was drawn)
+     */
+    int drawGlyph(rgb_matrix::Canvas* target, int x, int y, const rgb_matrix::Color& color, uint32_t codepoint,
+                  int clip_left, int clip_right) const;
+
+    /**
+     * OR a character into a 1-bit bitmap - bit x%32 of word x/32 of a row is column x
+     * @param bits The bitmap, row by row
+     * @param words_per_row Words in each row
+     * @param bitmap_width Width of the bitmap (nothing is set beyond it)
+     * @param bitmap_height Rows in the bitmap
+     * @param x Left of the character
+     * @param y Baseline
+     * @param codepoint Unicode code point
+     * @return The advance width (0 if nothing was drawn)
+     */
+    int blitGlyph(uint32_t* bits, int words_per_row, int bitmap_width, int bitmap_height, int x, int y, uint32_t codepoint) const;
+
+private:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t glyph_count;
+        uint64_t font_size;
+        int64_t font_mtime;
+        uint64_t font_path_hash;
+        int32_t height;
+        int32_t baseline;
+        uint32_t word_count;
+        uint32_t reserved;
+    };
+
+    struct Glyph {
+        uint32_t codepoint;
+        int16_t advance;
+        int16_t left;                                       // First column with a set pixel, from the pen position
+        int16_t top;                                        // First row with a set pixel, from the top of the font
+        uint8_t width;                                      // Columns from the first to the last set pixel
+        uint8_t height;                                     // Rows from the first to the last set pixel
+        uint32_t first_word;                                // Index of the glyph's first row in the words
+        uint16_t words_per_row;
+        uint16_t reserved;
+    };
+
+    static const uint32_t VERSION = 1;
+
+    // Built in memory, or pointing into the mapped cache file
+    std::vector<Glyph> built_glyphs;
+    std::vector<uint32_t> built_words;
+    const Glyph* glyph_table;
+    const uint32_t* words;
+    size_t glyph_count;
+    size_t word_count;
+    int font_height;
+    int font_baseline;
+
+    std::array<int16_t, 128> ascii_index;                   // Index of each ASCII glyph, or -1
+    int replacement_index;                                  // Index of U+FFFD, or -1
+
+    void* mapped;
+    size_t mapped_size;
+
+    void unmap();
+    void index();
+    const Glyph* find(uint32_t codepoint) const;
+    const Glyph* findOrReplacement(uint32_t codepoint) const;
+    static bool fontIdentity(const std::string& font_path, uint64_t& size, int64_t& mtime, uint64_t& path_hash);
+};
+
+#endif // GLYPH_ATLAS_H
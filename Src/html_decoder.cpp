@@ -0,0 +1,297 @@
+// Train Display - an RGB matrix departure board for the Raspberry Pi
+// HTML decoder for Network Rail (NRCC) messages
+// Version 1.0
+// Instructions, fixes and issues at https://github.com/jonmorrissmith/RGB_Matrix_Train_Departure_Board
+//
+#include "html_decoder.h"
+#include <cstring>
+#include <cstdint>
+
+namespace {
+
+// Every byte is classified once, up-front, so the main loop is a single table lookup per character
+enum CharClass : unsigned char { PLAIN, SPACE, CONTROL, TAG_OPEN, ENTITY };
+
+struct CharClassTable {
+    unsigned char cls[256];
+
+    CharClassTable() {
+        for (int c = 0; c < 256; c++) cls[c] = PLAIN;
+        for (int c = 0; c < 32; c++) cls[c] = CONTROL;
+        cls[127] = CONTROL;
+        cls[static_cast<unsigned char>(' ')] = SPACE;
+        cls[static_cast<unsigned char>('\t')] = SPACE;
+        cls[static_cast<unsigned char>('\n')] = SPACE;
+        cls[static_cast<unsigned char>('\r')] = SPACE;
+        cls[static_cast<unsigned char>('\f')] = SPACE;
+        cls[static_cast<unsigned char>('\v')] = SPACE;
+        cls[static_cast<unsigned char>('<')] = TAG_OPEN;
+        cls[static_cast<unsigned char>('&')] = ENTITY;
+    }
+};
+
+const CharClassTable char_table;
+
+// Named entities seen in NRCC feeds
+// Typographic characters are replaced with ASCII so they display in any font
+struct NamedEntity {
+    const char* name;
+    size_t length;
+    const char* text;
+};
+
+const NamedEntity named_entities[] = {
+    {"amp",    3, "&"},
+    {"lt",     2, "<"},
+    {"gt",     2, ">"},
+    {"quot",   4, "\""},
+    {"apos",   4, "'"},
+    {"nbsp",   4, " "},
+    {"ndash",  5, "-"},
+    {"mdash",  5, "-"},
+    {"minus",  5, "-"},
+    {"lsquo",  5, "'"},
+    {"rsquo",  5, "'"},
+    {"sbquo",  5, "'"},
+    {"ldquo",  5, "\""},
+    {"rdquo",  5, "\""},
+    {"bdquo",  5, "\""},
+    {"hellip", 6, "..."},
+    {"bull",   4, "*"},
+    {"middot", 6, "."},
+    {"pound",  5, "\xC2\xA3"},
+    {"euro",   4, "\xE2\x82\xAC"},
+    {"copy",   4, "(c)"},
+    {"reg",    3, "(R)"},
+    {"eacute", 6, "\xC3\xA9"},
+};
+
+// Tags which separate blocks of text - these become a space, all other tags are removed
+const char* const block_tags[] = { "p", "br", "div", "li", "ul", "ol", "tr", "td", "h1", "h2", "h3", "h4", "h5", "h6" };
+
+// The same typographic replacements for numeric entities (e.g. &#8211;)
+const char* numericReplacement(uint32_t code_point) {
+    switch (code_point) {
+        case 160:  return " ";     // non-breaking space
+        case 8211:                 // en dash
+        case 8212:                 // em dash
+        case 8722: return "-";     // minus
+        case 8216:                 // left single quote
+        case 8217:                 // right single quote
+        case 8218: return "'";     // low single quote
+        case 8220:                 // left double quote
+        case 8221:                 // right double quote
+        case 8222: return "\"";    // low double quote
+        case 8226: return "*";     // bullet
+        case 8230: return "...";   // ellipsis
+        default:   return nullptr;
+    }
+}
+
+// Decoder state - the output buffer and a pending (collapsed) space
+struct Writer {
+    std::string& output;
+    size_t start;
+    bool pending_space;
+
+    explicit Writer(std::string& out) : output(out), start(out.size()), pending_space(false) {}
+
+    // Whitespace is only written once something follows it, which trims both ends of the message
+    void space() {
+        pending_space = true;
+    }
+
+    void flushSpace() {
+        if (pending_space) {
+            if (output.size() > start) output.push_back(' ');
+            pending_space = false;
+        }
+    }
+
+    void append(const char* text, size_t length) {
+        flushSpace();
+        output.append(text, length);
+    }
+
+    void appendText(const char* text) {
+        if (text[0] == ' ' && text[1] == '\0') {
+            space();
+        } else {
+            append(text, std::strlen(text));
+        }
+    }
+
+    void appendCodePoint(uint32_t code_point) {
+        const char* replacement = numericReplacement(code_point);
+        if (replacement) {
+            appendText(replacement);
+            return;
+        }
+
+        char utf8[4];
+        size_t length;
+        if (code_point < 0x20) {
+            space();
+            return;
+        } else if (code_point < 0x80) {
+            utf8[0] = static_cast<char>(code_point);
+            length = 1;
+        } else if (code_point < 0x800) {
+            utf8[0] = static_cast<char>(0xC0 | (code_point >> 6));
+            utf8[1] = static_cast<char>(0x80 | (code_point & 0x3F));
+            length = 2;
+        } else if (code_point < 0x10000) {
+            if (code_point >= 0xD800 && code_point <= 0xDFFF) return;   // Surrogates aren't characters
+            utf8[0] = static_cast<char>(0xE0 | (code_point >> 12));
+            utf8[1] = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+            utf8[2] = static_cast<char>(0x80 | (code_point & 0x3F));
+            length = 3;
+        } else if (code_point <= 0x10FFFF) {
+            utf8[0] = static_cast<char>(0xF0 | (code_point >> 18));
+            utf8[1] = static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+            utf8[2] = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+            utf8[3] = static_cast<char>(0x80 | (code_point & 0x3F));
+            length = 4;
+        } else {
+            return;
+        }
+        append(utf8, length);
+    }
+};
+
+inline char lowerAscii(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+}
+
+inline bool isAsciiAlpha(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+inline bool isAsciiAlnum(char c) {
+    return isAsciiAlpha(c) || (c >= '0' && c <= '9');
+}
+
+// Is the tag name at text[0..length) a block tag (case-insensitive)?
+bool isBlockTag(const char* text, size_t length) {
+    for (const char* tag : block_tags) {
+        size_t tag_length = std::strlen(tag);
+        if (tag_length != length) continue;
+        size_t i = 0;
+        while (i < length && lowerAscii(text[i]) == tag[i]) i++;
+        if (i == length) return true;
+    }
+    return false;
+}
+
+// Decode the entity starting at html[pos] == '&'
+// Returns the number of characters consumed, or 0 if this isn't a recognised entity
+size_t decodeEntity(const char* html, size_t pos, size_t end, Writer& writer) {
+    const size_t max_entity_length = 10;
+    size_t i = pos + 1;
+
+    if (i < end && html[i] == '#') {
+        // Numeric - &#8211; or &#x2013;
+        uint32_t code_point = 0;
+        bool hex = false;
+        size_t digits = 0;
+        i++;
+        if (i < end && (html[i] == 'x' || html[i] == 'X')) {
+            hex = true;
+            i++;
+        }
+        while (i < end && digits < 8) {
+            char c = html[i];
+            uint32_t value;
+            if (c >= '0' && c <= '9') value = c - '0';
+            else if (hex && c >= 'a' && c <= 'f') value = c - 'a' + 10;
+            else if (hex && c >= 'A' && c <= 'F') value = c - 'A' + 10;
+            else break;
+            code_point = code_point * (hex ? 16 : 10) + value;
+            digits++;
+            i++;
+        }
+        if (digits == 0 || i >= end || html[i] != ';') return 0;
+        writer.appendCodePoint(code_point);
+        return i + 1 - pos;
+    }
+
+    // Named - &amp;
+    size_t name_start = i;
+    while (i < end && i - name_start < max_entity_length && isAsciiAlnum(html[i])) i++;
+    if (i >= end || html[i] != ';' || i == name_start) return 0;
+
+    size_t name_length = i - name_start;
+    for (const NamedEntity& entity : named_entities) {
+        if (entity.length == name_length && std::memcmp(entity.name, html + name_start, name_length) == 0) {
+            writer.appendText(entity.text);
+            return i + 1 - pos;
+        }
+    }
+    return 0;
+}
+
+// Skip the tag starting at html[pos] == '<'
+// Returns the number of characters consumed, or 0 if this isn't a tag (e.g. "delays < 10 minutes")
+size_t skipTag(const char* html, size_t pos, size_t end, Writer& writer) {
+    size_t i = pos + 1;
+    if (i >= end) return 0;
+    if (html[i] == '/') i++;
+    if (i >= end || !(isAsciiAlpha(html[i]) || html[i] == '!')) return 0;
+
+    const void* close = std::memchr(html + i, '>', end - i);
+    if (!close) return 0;
+    size_t tag_end = static_cast<const char*>(close) - html;
+
+    size_t name_start = i;
+    while (i < tag_end && isAsciiAlnum(html[i])) i++;
+    if (isBlockTag(html + name_start, i - name_start)) {
+        writer.space();
+    }
+    return tag_end + 1 - pos;
+}
+
+} // namespace
+
+void appendDecodedHtml(const char* html, size_t length, std::string& output) {
+    const char* text = html;
+    const size_t end = length;
+    Writer writer(output);
+    size_t i = 0;
+
+    while (i < end) {
+        switch (char_table.cls[static_cast<unsigned char>(text[i])]) {
+            case PLAIN: {
+                // Copy the whole run of plain characters in one go
+                size_t run_start = i;
+                while (i < end && char_table.cls[static_cast<unsigned char>(text[i])] == PLAIN) i++;
+                writer.append(text + run_start, i - run_start);
+                break;
+            }
+            case SPACE:
+                writer.space();
+                i++;
+                break;
+            case CONTROL:
+                i++;
+                break;
+            case TAG_OPEN: {
+                size_t consumed = skipTag(text, i, end, writer);
+                if (consumed == 0) {
+                    writer.append("<", 1);
+                    consumed = 1;
+                }
+                i += consumed;
+                break;
+            }
+            case ENTITY: {
+                size_t consumed = decodeEntity(text, i, end, writer);
+                if (consumed == 0) {
+                    writer.append("&", 1);
+                    consumed = 1;
+                }
+                i += consumed;
+                break;
+            }
+        }
+    }
+}
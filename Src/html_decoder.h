@@ -0,0 +1,31 @@
+// Train Display - an RGB matrix departure board for the Raspberry Pi
+// HTML decoder for Network Rail (NRCC) messages
+// Version 1.0
+// Instructions, fixes and issues at https://github.com/jonmorrissmith/RGB_Matrix_Train_Departure_Board
+//
+// NRCC messages arrive as fragments of HTML - links, paragraphs, line breaks and entities.
+// The decoder strips the tags, decodes named and numeric entities and collapses whitespace
+// in a single pass, appending to the caller's buffer without any temporary strings.
+//
+#ifndef HTML_DECODER_H
+#define HTML_DECODER_H
+
+#include <string>
+
+/**
+ * Decode an HTML fragment into display text and append it to output
+ * Tags are removed (block tags such as <p> and <br> become a space), entities are decoded,
+ * runs of whitespace become a single space and leading/trailing whitespace is dropped.
+ * Typographic characters (dashes, curly quotes, non-breaking spaces) become their ASCII equivalents.
+ * @param html The HTML fragment
+ * @param length The length of the fragment
+ * @param output The buffer to append the decoded text to - reserve capacity before calling to avoid reallocation
+ */
+void appendDecodedHtml(const char* html, size_t length, std::string& output);
+
+// As above, for a whole string
+inline void appendDecodedHtml(const std::string& html, std::string& output) {
+    appendDecodedHtml(html.data(), html.length(), output);
+}
+
+#endif // HTML_DECODER_H
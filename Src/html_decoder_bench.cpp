@@ -0,0 +1,139 @@
+// HTML decoder benchmark
+//
+// Times the NRCC message decoder against the previous substr-based tag stripper
+// over a set of messages recorded from the departure board feeds.
+//
+// -iterations  Number of passes over the messages (default 100000)
+// -show        If set to 'y' then print each message before and after decoding
+//
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include "html_decoder.h"
+
+// Global debug flag
+bool debug_mode = false;
+
+// Messages as they arrive in the 'nrccMessages' field
+static const std::vector<std::string> recorded_messages = {
+    "<p>Disruption between London Bridge and Brighton expected until the end of the day. "
+    "More details can be found in <a href=\"https://www.nationalrail.co.uk/service-disruptions/london-bridge-brighton-20250301/\">Latest Travel News</a>.</p>",
+
+    "Trains between Cambridge and King's Lynn may be cancelled or delayed by up to 20 minutes. "
+    "This is due to a broken down train. More details can be found in "
+    "<A href=\"http://nationalrail.co.uk/service_disruptions/345678.aspx\">Latest Travel News.</A>",
+
+    "\nPoor weather is affecting journeys across the network &ndash; please check before you travel. "
+    "Tickets are being accepted on &quot;any reasonable route&quot;.",
+
+    "<P>Engineering works: buses replace trains between Ely &amp; Peterborough on Sunday.<br/>"
+    "Journeys will take up to 30&nbsp;minutes longer.</P>",
+
+    "Lifts at this station are out of order &#8211; step-free access is available via platform 2. "
+    "We&#39;re sorry for any inconvenience this may cause.",
+
+    "Short notice alterations: the 17:42 to Cambridge will start from Finsbury Park. "
+    "<a href=\"https://www.thameslinkrailway.com/travel-information/travel-updates\">Check before you travel</a> "
+    "&lt;updated 16:05&gt;",
+};
+
+// The previous implementation, kept here as the baseline
+static std::string legacyProcessHtmlTags(const std::string& html) {
+    std::string result;
+    bool inTag = false;
+    for (size_t i = 0; i < html.length(); ++i) {
+        if (html[i] == '<') {
+            inTag = true;
+        } else if (html[i] == '>') {
+            inTag = false;
+        } else if (!inTag) {
+            if (i + 5 < html.length() && html.substr(i, 5) == "&quot;") {
+                result += "\"";
+                i += 4;
+            } else if (i + 4 < html.length() && html.substr(i, 4) == "&lt;") {
+                result += "<";
+                i += 3;
+            } else if (i + 4 < html.length() && html.substr(i, 4) == "&gt;") {
+                result += ">";
+                i += 3;
+            } else if (i + 5 < html.length() && html.substr(i, 5) == "&amp;") {
+                result += "&";
+                i += 4;
+            } else if (i + 2 < html.length() && html.substr(i, 2) == "\n") {
+                result += "";
+                i += 1;
+            } else {
+                result += html[i];
+            }
+        }
+    }
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    long iterations = 100000;
+    bool show = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string param = argv[i];
+        if (param == "-iterations" && i + 1 < argc) {
+            iterations = std::stol(argv[++i]);
+        } else if (param == "-show" && i + 1 < argc) {
+            show = (std::string(argv[++i]) == "y");
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [-iterations <number>] [-show y]" << std::endl;
+            return 1;
+        }
+    }
+
+    size_t total_bytes = 0;
+    for (const auto& message : recorded_messages) {
+        total_bytes += message.length();
+    }
+
+    if (show) {
+        for (const auto& message : recorded_messages) {
+            std::string decoded;
+            appendDecodedHtml(message, decoded);
+            std::cout << "Input:   " << message << std::endl;
+            std::cout << "Legacy:  " << legacyProcessHtmlTags(message) << std::endl;
+            std::cout << "Decoded: " << decoded << std::endl << std::endl;
+        }
+    }
+
+    // Baseline
+    size_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (long n = 0; n < iterations; n++) {
+        for (const auto& message : recorded_messages) {
+            checksum += legacyProcessHtmlTags(message).length();
+        }
+    }
+    auto legacy_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+    // Decoder - one buffer reused across messages, as the parser does for a board
+    std::string output;
+    output.reserve(total_bytes);
+    start = std::chrono::steady_clock::now();
+    for (long n = 0; n < iterations; n++) {
+        for (const auto& message : recorded_messages) {
+            output.clear();
+            appendDecodedHtml(message, output);
+            checksum += output.length();
+        }
+    }
+    auto decoder_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+    double messages = static_cast<double>(iterations) * recorded_messages.size();
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "messages=" << recorded_messages.size() << " bytes=" << total_bytes << " iterations=" << iterations << std::endl;
+    std::cout << "legacy_ns_per_message=" << legacy_ns / messages << std::endl;
+    std::cout << "decoder_ns_per_message=" << decoder_ns / messages << std::endl;
+    std::cout << "speedup=" << static_cast<double>(legacy_ns) / decoder_ns << std::endl;
+    std::cout << "checksum=" << checksum << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,56 @@
+// Train Display - an RGB matrix departure board for the Raspberry Pi
+// Layer cache
+// Version 1.0
+// Instructions, fixes and issues at https://github.com/jonmorrissmith/RGB_Matrix_Train_Departure_Board
+//
+#include "layer_cache.h"
+#include <algorithm>
+
+LayerCache::LayerCache() : hits(0), misses(0), restored_bytes(0) {
+}
+
+LayerCache::Layer* LayerCache::find(unsigned region, int state) {
+    for (Layer& layer : layers) {
+        if (layer.region == region && layer.state == state) {
+            return &layer;
+        }
+    }
+    return nullptr;
+}
+
+bool LayerCache::restore(unsigned region, int state, const Rect& rect, FrameBuffer& target) {
+    Layer* layer = find(region, state);
+    // The region can move (the fourth row ends where the clock starts), so the layer must be from the same place
+    if (layer && layer->rect.x == rect.x && layer->rect.y == rect.y &&
+        layer->rect.width == rect.width && layer->rect.height == rect.height &&
+        target.deserialize(rect, layer->pixels)) {
+        hits++;
+        restored_bytes += layer->pixels.size();
+        return true;
+    }
+    misses++;
+    return false;
+}
+
+void LayerCache::store(unsigned region, int state, const Rect& rect, const FrameBuffer& source) {
+    Layer* layer = find(region, state);
+    if (!layer) {
+        layers.push_back(Layer());
+        layer = &layers.back();
+        layer->region = region;
+        layer->state = state;
+    }
+    layer->rect = rect;
+    source.serialize(rect, layer->pixels);
+}
+
+void LayerCache::invalidate(unsigned regions) {
+    layers.erase(std::remove_if(layers.begin(), layers.end(),
+                                [regions](const Layer& layer) { return (layer.region & regions) != 0; }),
+                 layers.end());
+}
+
+void LayerCache::writeReport(std::ostream& out) const {
+    out << "layer_cache: layers=" << layers.size() << " hits=" << hits << " misses=" << misses
+        << " restored_bytes=" << restored_bytes << std::endl;
+}
@@ -0,0 +1,77 @@
+// Train Display - an RGB matrix departure board for the Raspberry Pi
+// Layer cache
+// Version 1.0
+// Instructions, fixes and issues at https://github.com/jonmorrissmith/RGB_Matrix_Train_Departure_Board
+//
+// Finished pixels of the static parts of the board, so that flipping a row back to something it has shown
+// before is a copy rather than a redraw.
+//
+// Most of the board only changes with new data or a toggle - the first departure with its ETD or coaches,
+// the 2nd or 3rd train, the location - and the toggles flip between the same few states. Each static region
+// is kept once per state it's been drawn in (serialised from the frame buffer), and a toggle restores it
+// with a memcpy per row. The scrolling text and the clock are always drawn.
+//
+// Layers for a region are dropped when new data changes it.
+//
+#ifndef LAYER_CACHE_H
+#define LAYER_CACHE_H
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "damage_tracker.h"
+#include "frame_buffer.h"
+
+class LayerCache {
+public:
+    LayerCache();
+
+    /**
+     * Put a cached layer back into the frame buffer
+     * @param region The region (a damage tracker bit)
+     * @param state What the region is showing (its toggle state)
+     * @param rect Where the region is - a layer saved somewhere else doesn't match
+     * @param target The frame buffer
+     * @return true if the layer was cached and has been restored
+     */
+    bool restore(unsigned region, int state, const Rect& rect, FrameBuffer& target);
+
+    /**
+     * Save a region of the frame buffer once it's been drawn
+     * @param region The region (a damage tracker bit)
+     * @param state What the region is showing
+     * @param rect Where the region is
+     * @param source The frame buffer
+     */
+    void store(unsigned region, int state, const Rect& rect, const FrameBuffer& source);
+
+    /**
+     * Drop the layers of regions whose content has changed
+     * @param regions Bit mask of regions
+     */
+    void invalidate(unsigned regions);
+
+    /**
+     * Write the hit and miss counts since start-up
+     * @param out The stream to write to
+     */
+    void writeReport(std::ostream& out) const;
+
+private:
+    struct Layer {
+        unsigned region;
+        int state;
+        Rect rect;
+        std::vector<uint8_t> pixels;
+    };
+
+    std::vector<Layer> layers;                              // A handful - one per static region and state
+
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t restored_bytes;
+
+    Layer* find(unsigned region, int state);
+};
+
+#endif // LAYER_CACHE_H
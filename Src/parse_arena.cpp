@@ -0,0 +1,62 @@
+// Train Display - an RGB matrix departure board for the Raspberry Pi
+// Arena allocation for parsing
+// Version 1.0
+// Instructions, fixes and issues at https://github.com/jonmorrissmith/RGB_Matrix_Train_Departure_Board
+//
+#include "parse_arena.h"
+#include <cstdlib>
+#include <cstddef>
+
+thread_local ParseArena* ParseArena::active = nullptr;
+
+ParseArena::ParseArena(size_t size) : block_size(size), current_block(0), offset(0), used(0), live(0) {
+}
+
+ParseArena::~ParseArena() {
+    assert(live == 0 && "ParseArena destroyed with allocations still alive");
+    for (const Block& block : blocks) {
+        std::free(block.data);
+    }
+}
+
+void ParseArena::reset() {
+    assert(live == 0 && "ParseArena reset with allocations still alive");
+    current_block = 0;
+    offset = 0;
+    used = 0;
+}
+
+size_t ParseArena::capacity() const {
+    size_t total = 0;
+    for (const Block& block : blocks) {
+        total += block.size;
+    }
+    return total;
+}
+
+// The current block is full - move on to the next kept block that's big enough, or add one
+// Blocks come from malloc, so the start of a block is aligned for any type
+void* ParseArena::allocateSlow(size_t size, size_t alignment) {
+    if (alignment > alignof(std::max_align_t)) {
+        throw std::bad_alloc();
+    }
+    
+    if (current_block < blocks.size()) {
+        current_block++;
+    }
+    while (current_block < blocks.size() && blocks[current_block].size < size) {
+        current_block++;
+    }
+    if (current_block == blocks.size()) {
+        size_t new_size = size > block_size ? size : block_size;
+        char* data = static_cast<char*>(std::malloc(new_size));
+        if (!data) {
+            throw std::bad_alloc();
+        }
+        blocks.push_back(Block{data, new_size});
+    }
+    
+    offset = size;
+    used += size;
+    return blocks[current_block].data;
+}
@@ -0,0 +1,177 @@
+// Train Display - an RGB matrix departure board for the Raspberry Pi
+// Arena allocation for parsing
+// Version 1.0
+// Instructions, fixes and issues at https://github.com/jonmorrissmith/RGB_Matrix_Train_Departure_Board
+//
+// Parsing a payload builds a JSON DOM of a few thousand small objects which are all thrown away together
+// once the services have been extracted. Rather than malloc and free each one, the DOM is built in a
+// ParseArena - a set of large blocks handed out in order and rewound in one go for the next refresh.
+// The blocks are kept, so once the arena has grown to fit a board a refresh makes no calls to malloc for the DOM.
+//
+// arena_json is nlohmann::json with every allocation (objects, arrays and strings) going to the arena
+// made current by a ParseArena::Scope on this thread. Rules:
+//   - create and destroy an arena_json inside the same Scope - memory from the arena is never freed individually
+//   - reset() the arena only when nothing allocated from it is still alive
+// Both are checked (assert): the arena counts its live allocations, and a Scope ending or a reset() with any
+// still alive stops the program.
+// Outside any Scope arena_json falls back to the normal heap, so it's still safe to use anywhere else.
+// Each allocation records where it came from, so it's freed correctly wherever it's destroyed - heap memory
+// freed inside a Scope goes back to the heap, and arena memory is never handed to the heap.
+//
+#ifndef PARSE_ARENA_H
+#define PARSE_ARENA_H
+
+#include <nlohmann/json.hpp>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+class ParseArena {
+public:
+    /**
+     * @param block_size Size of each block of memory - larger requests get a block of their own
+     */
+    explicit ParseArena(size_t block_size = 64 * 1024);
+    ~ParseArena();
+
+    ParseArena(const ParseArena&) = delete;
+    ParseArena& operator=(const ParseArena&) = delete;
+
+    /**
+     * Allocate from the arena - the memory stays valid until reset()
+     * @param size Number of bytes
+     * @param alignment Alignment (a power of two)
+     * @return The allocated memory
+     */
+    void* allocate(size_t size, size_t alignment) {
+        size_t aligned = (offset + alignment - 1) & ~(alignment - 1);
+        if (current_block < blocks.size() && aligned + size <= blocks[current_block].size) {
+            offset = aligned + size;
+            used += size;
+            return blocks[current_block].data + aligned;
+        }
+        return allocateSlow(size, alignment);
+    }
+
+    /**
+     * Rewind the arena so its memory can be used again - the blocks themselves are kept
+     * Everything allocated since the last reset must already have been destroyed
+     */
+    void reset();
+
+    size_t bytesUsed() const { return used; }           // Bytes allocated since the last reset
+    size_t capacity() const;                            // Bytes held in blocks
+    size_t blockCount() const { return blocks.size(); }
+
+    // The arena allocations go to on this thread - null if there isn't one
+    static ParseArena* current() { return active; }
+
+    // Allocations from the arena not yet freed - kept by ArenaAllocator
+    size_t liveAllocations() const { return live; }
+    void allocated() { live++; }
+    void freed() { assert(live > 0); live--; }
+
+    // Makes an arena current on this thread for the lifetime of the Scope
+    // Everything allocated from the arena must be freed before the Scope ends
+    class Scope {
+    public:
+        explicit Scope(ParseArena& arena) : scoped(arena), previous(active) { active = &arena; }
+        ~Scope() {
+            assert((previous == &scoped || scoped.live == 0) && "arena memory outlived its ParseArena::Scope");
+            active = previous;
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        ParseArena& scoped;
+        ParseArena* previous;
+    };
+
+private:
+    struct Block {
+        char* data;
+        size_t size;
+    };
+
+    size_t block_size;
+    std::vector<Block> blocks;
+    size_t current_block;           // Block being allocated from
+    size_t offset;                  // Next free byte in the current block
+    size_t used;
+    size_t live;                    // Allocations not yet freed
+
+    void* allocateSlow(size_t size, size_t alignment);
+
+    static thread_local ParseArena* active;
+};
+
+// Standard allocator interface to the current ParseArena - stateless, as nlohmann::basic_json requires
+// Where a block came from is recorded just in front of it (the owning arena, or null for the heap), so
+// deallocate() never has to guess from the Scope it happens to be called in - and any two are equal
+template <class T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+
+    ArenaAllocator() noexcept {}
+    template <class U> ArenaAllocator(const ArenaAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        static_assert(alignof(T) <= alignof(std::max_align_t), "ArenaAllocator can't over-align");
+        if (n > (static_cast<size_t>(-1) - header()) / sizeof(T)) {
+            throw std::bad_alloc();
+        }
+        size_t bytes = header() + n * sizeof(T);
+        ParseArena* arena = ParseArena::current();
+        char* block;
+        if (arena) {
+            block = static_cast<char*>(arena->allocate(bytes, alignment()));
+            arena->allocated();
+        } else {
+            block = static_cast<char*>(::operator new(bytes));
+        }
+        char* data = block + header();
+        owner(data) = arena;
+        return reinterpret_cast<T*>(data);
+    }
+
+    // Memory from the arena is released by reset() - only heap memory is freed here
+    void deallocate(T* ptr, size_t) noexcept {
+        char* data = reinterpret_cast<char*>(ptr);
+        ParseArena* arena = owner(data);
+        if (arena) {
+            arena->freed();
+        } else {
+            ::operator delete(data - header());
+        }
+    }
+
+    template <class U> bool operator==(const ArenaAllocator<U>&) const noexcept { return true; }
+    template <class U> bool operator!=(const ArenaAllocator<U>&) const noexcept { return false; }
+
+private:
+    // The owner goes in the last pointer-sized bytes before the data, which stays aligned for T
+    // (functions rather than constants - T may still be incomplete when the allocator type is named)
+    static constexpr size_t alignment() {
+        return alignof(T) > alignof(ParseArena*) ? alignof(T) : alignof(ParseArena*);
+    }
+    static constexpr size_t header() {
+        return (sizeof(ParseArena*) + alignof(T) - 1) / alignof(T) * alignof(T);
+    }
+
+    static ParseArena*& owner(char* data) {
+        return *reinterpret_cast<ParseArena**>(data - sizeof(ParseArena*));
+    }
+};
+
+using arena_string = std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;
+
+using arena_json = nlohmann::basic_json<std::map, std::vector, arena_string, bool,
+                                        std::int64_t, std::uint64_t, double, ArenaAllocator>;
+
+#endif // PARSE_ARENA_H
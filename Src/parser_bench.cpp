@@ -0,0 +1,252 @@
+// Parser benchmark
+//
+// Times the parser stages over recorded API payloads so every parser change comes with numbers.
+// Runs headless - it only needs the parser, no matrix library.
+//
+// -data        A payload (JSON file) to benchmark - repeat for several (default: the Test_data corpus)
+// -iterations  Number of times each stage is run per payload (default 2000)
+// -debug       If set to 'y' then switch on debug info in the parser code (slow - for checking only)
+//
+// Output is one line per payload and stage, in key=value form:
+//   payload=<file> stage=<stage> iterations=<n> ns_per_op=<ns> allocs_per_op=<n> bytes_per_op=<n>
+// followed by peak_rss_kb=<kb> for the whole run.
+//
+// Stages:
+//   updateData                   Parse a payload into the service table (includes NRCC processing)
+//   nrcc                         Decode the NRCC messages of a payload on their own
+//   createOrderedDepartureList   Order the departures by time
+//   findServices                 Find the first three departures (includes ordering)
+//   getCallingPoints             Build the calling-point text for every service (first, uncached, call)
+//
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <sys/resource.h>
+#include "train_service_parser.h"
+#include "html_decoder.h"
+
+// Global debug flag
+bool debug_mode = false;
+
+// Allocation counting - every allocation in the process goes through these
+// (GCC warns that free() doesn't match new once these are inlined - they do match here)
+#if defined(__GNUC__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+static std::atomic<size_t> allocation_count(0);
+static std::atomic<size_t> allocation_bytes(0);
+
+void* operator new(size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+    void* ptr = std::malloc(size ? size : 1);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+// Measures one stage - time and allocations between start() and stop(), which can be called repeatedly
+class StageTimer {
+public:
+    StageTimer() : elapsed_ns(0), allocations(0), bytes(0) {}
+
+    void start() {
+        start_allocations = allocation_count.load(std::memory_order_relaxed);
+        start_bytes = allocation_bytes.load(std::memory_order_relaxed);
+        start_time = std::chrono::steady_clock::now();
+    }
+
+    void stop() {
+        auto end_time = std::chrono::steady_clock::now();
+        elapsed_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time).count();
+        allocations += allocation_count.load(std::memory_order_relaxed) - start_allocations;
+        bytes += allocation_bytes.load(std::memory_order_relaxed) - start_bytes;
+    }
+
+    void report(const std::string& payload, const char* stage, size_t operations) const {
+        double ops = static_cast<double>(operations ? operations : 1);
+        std::cout << std::fixed << std::setprecision(1)
+                  << "payload=" << payload
+                  << " stage=" << stage
+                  << " iterations=" << operations
+                  << " ns_per_op=" << elapsed_ns / ops
+                  << " allocs_per_op=" << allocations / ops
+                  << " bytes_per_op=" << bytes / ops
+                  << std::endl;
+    }
+
+private:
+    std::chrono::steady_clock::time_point start_time;
+    size_t start_allocations;
+    size_t start_bytes;
+    long long elapsed_ns;
+    size_t allocations;
+    size_t bytes;
+};
+
+static std::string readFile(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file) {
+        throw std::runtime_error("Cannot open file: " + filename);
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+// The NRCC message text in a payload, as the parser finds it
+static std::vector<std::string> nrccMessages(const std::string& payload) {
+    std::vector<std::string> messages;
+    json data = json::parse(payload, nullptr, false);
+    if (data.is_object() && data.contains("nrccMessages") && data["nrccMessages"].is_array()) {
+        for (const auto& message : data["nrccMessages"]) {
+            if (message.contains("Value") && message["Value"].is_string()) {
+                messages.push_back(message["Value"].get<std::string>());
+            } else if (message.contains("value") && message["value"].is_string()) {
+                messages.push_back(message["value"].get<std::string>());
+            }
+        }
+    }
+    return messages;
+}
+
+static void benchmarkPayload(const std::string& filename, long iterations) {
+    std::string payload = readFile(filename);
+    std::string name = filename.substr(filename.find_last_of('/') + 1);
+    TrainServiceParser parser;
+
+    // Warm up (and check the payload parses)
+    parser.updateData(payload);
+    parser.findServices();
+    size_t services = parser.getNumberOfServices();
+
+    // updateData
+    StageTimer update_timer;
+    update_timer.start();
+    for (long n = 0; n < iterations; n++) {
+        parser.updateData(payload);
+    }
+    update_timer.stop();
+    update_timer.report(name, "updateData", iterations);
+
+    // NRCC processing - decoding into one reserved buffer, as updateData does
+    std::vector<std::string> messages = nrccMessages(payload);
+    size_t checksum = 0;
+    StageTimer nrcc_timer;
+    nrcc_timer.start();
+    for (long n = 0; n < iterations; n++) {
+        size_t total_length = 0;
+        for (const auto& message : messages) total_length += message.length() + 3;
+        std::string decoded;
+        decoded.reserve(total_length);
+        for (const auto& message : messages) {
+            if (!decoded.empty()) decoded += " | ";
+            appendDecodedHtml(message, decoded);
+        }
+        checksum += decoded.length();
+    }
+    nrcc_timer.stop();
+    nrcc_timer.report(name, "nrcc", iterations);
+
+    // createOrderedDepartureList
+    StageTimer order_timer;
+    order_timer.start();
+    for (long n = 0; n < iterations; n++) {
+        parser.createOrderedDepartureList();
+    }
+    order_timer.stop();
+    order_timer.report(name, "createOrderedDepartureList", iterations);
+
+    // findServices
+    StageTimer find_timer;
+    find_timer.start();
+    for (long n = 0; n < iterations; n++) {
+        parser.findServices();
+    }
+    find_timer.stop();
+    find_timer.report(name, "findServices", iterations);
+
+    // getCallingPoints - the text is cached once built, so reload the board (untimed) before each round
+    StageTimer calling_points_timer;
+    for (long n = 0; n < iterations; n++) {
+        parser.updateData(payload);
+        calling_points_timer.start();
+        for (size_t i = 0; i < services; i++) {
+            checksum += parser.getCallingPoints(i).length();
+        }
+        calling_points_timer.stop();
+    }
+    calling_points_timer.report(name, "getCallingPoints", iterations * services);
+
+    DEBUG_PRINT("Checksum " << checksum);
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> files;
+    long iterations = 2000;
+
+    for (int i = 1; i < argc; i++) {
+        std::string param = argv[i];
+        if (param == "-data" && i + 1 < argc) {
+            files.push_back(argv[++i]);
+        } else if (param == "-iterations" && i + 1 < argc) {
+            iterations = std::stol(argv[++i]);
+        } else if (param == "-debug" && i + 1 < argc) {
+            debug_mode = (std::string(argv[++i]) == "y");
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [-data <file>]... [-iterations <number>] [-debug y]" << std::endl;
+            return 1;
+        }
+    }
+
+    if (files.empty()) {
+        files = {
+            "Test_data/tiny_huxley.json",
+            "Test_data/typical_huxley.json",
+            "Test_data/typical_rdm.json",
+            "Test_data/huge_terminus_huxley.json"
+        };
+    }
+
+    try {
+        for (const auto& file : files) {
+            benchmarkPayload(file, iterations);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    std::cout << "peak_rss_kb=" << usage.ru_maxrss << std::endl;
+
+    return 0;
+}
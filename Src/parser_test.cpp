@@ -6,6 +6,9 @@
 //
 // -debug       Switches on debug info in the parser code
 // -platform    For use if you need to test a specific platform
+// -filter      For use if you need to test a filter expression
+// -to          For use if you need to test local destination filtering (comma separated CRS codes)
+// -snapshot    For use if you need to test board snapshots - the board is written to this file and loaded back
 // -data        Data to process - the output from an API call. Can be formatted or formatted JSON
 //              The -d flag on traindisplay dumps API output to /tmp/traindisplay_payload.json
 // -clean       If set to 'y' then all whitespace is removed
@@ -18,6 +21,7 @@
 #include <vector>
 #include <algorithm>
 #include <cctype>
+#include <chrono>
 #include "train_service_parser.h"
 
 // Global debug flag
@@ -91,6 +95,9 @@ int main(int argc, char* argv[]) {
     std::string debug;
     std::string data_file;
     std::string platform;
+    std::string filter;
+    std::string destinations;
+    std::string snapshot_file;
     std::string clean_data;
     std::string config_file;
     TrainServiceParser parser;
@@ -98,7 +105,6 @@ int main(int argc, char* argv[]) {
     size_t service;
     int departureNumber;
     size_t i;
-    bool yesno;
      
     
     // Parse command line arguments
@@ -111,15 +117,24 @@ int main(int argc, char* argv[]) {
             data_file = argv[++i];
         } else if (param == "-platform" && i + 1 < argc) {
             platform = argv[++i];
+        } else if (param == "-filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (param == "-to" && i + 1 < argc) {
+            destinations = argv[++i];
+        } else if (param == "-snapshot" && i + 1 < argc) {
+            snapshot_file = argv[++i];
         } else if (param == "-clean" && i + 1 < argc) {
             clean_data = argv[++i];
         } else if (param == "-f" && i + 1 < argc) {
             config_file = argv[++i];
         } else {
             std::cerr << "Error: Invalid parameter or missing value: " << param << std::endl;
-            std::cerr << "Usage: " << argv[0] << " -data <string> [-platform <string>] [-clean <string>] [-f <string>] [-debug <string>]" << std::endl;
+            std::cerr << "Usage: " << argv[0] << " -data <string> [-platform <string>] [-filter <string>] [-to <string>] [-snapshot <string>] [-clean <string>] [-f <string>] [-debug <string>]" << std::endl;
             std::cerr << "-data json data file" << std::endl;
             std::cerr << "-platform select a platform" << std::endl;
+            std::cerr << "-filter test a filter expression" << std::endl;
+            std::cerr << "-to test local destination filtering (CRS codes, comma separated)" << std::endl;
+            std::cerr << "-snapshot test writing and loading a board snapshot (file to use)" << std::endl;
             std::cerr << "-clean y  remove whitespace" << std::endl;
             std::cerr << "-f config file (not currently in use)" << std::endl;
             std::cerr << "-debug y  switch on debug info in the parser code" << std::endl;
@@ -156,6 +171,15 @@ int main(int argc, char* argv[]) {
      if (!platform.empty()) {
          std::cout << "Platform: " << platform << std::endl;
      }
+     if (!filter.empty()) {
+         std::cout << "Filter: " << filter << std::endl;
+     }
+     if (!destinations.empty()) {
+         std::cout << "Destinations: " << destinations << std::endl;
+     }
+     if (!snapshot_file.empty()) {
+         std::cout << "Snapshot file: " << snapshot_file << std::endl;
+     }
      if (!clean_data.empty()) {
          std::cout << "Clean data: " << clean_data << std::endl;
      }
@@ -170,6 +194,10 @@ int main(int argc, char* argv[]) {
 
      std::cout << "------------------------------" << std::endl;
 
+     // The snapshot is written as part of the update
+     if (!snapshot_file.empty()) {
+         parser.setSnapshotPath(snapshot_file);
+     }
      parser.updateData(data);
 
     // Functions to test
@@ -181,6 +209,7 @@ int main(int argc, char* argv[]) {
     // bool isCancelled(size_t serviceIndex);
     // bool isDelayed(size_t serviceIndex);
     // size_t getNumberOfServices();
+    // size_t getNumberOfDroppedServices();
     // size_t getFirstDeparture();
     // size_t getSecondDeparture();
     // size_t getThirdDeparture();
@@ -198,6 +227,7 @@ int main(int argc, char* argv[]) {
 
     num_services = parser.getNumberOfServices();
     std::cout << "Number of Services: " << num_services << std::endl;;
+    std::cout << "Number of malformed Services dropped: " << parser.getNumberOfDroppedServices() << std::endl;
 
     for (i=0; i< num_services; i++) {
        std::cout << "==========================================================" << std::endl;
@@ -267,6 +297,103 @@ int main(int argc, char* argv[]) {
         std::cout << "Third: Platform " << parser.getPlatform(service) << " at " << parser.getScheduledDepartureTime(service) << " to " << parser.getDestination(service) << std::endl;
        }
     
+    if (!filter.empty()) {
+        std::cout << "==========================================================" << std::endl;
+        std::cout << "=========== Testing filter expression ====================" << std::endl;
+        std::cout << "======= First three departures matching " << filter << std::endl;
+        try {
+            parser.setServiceFilter(filter);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+        parser.findServices();
+        std::cout << "First three departures" << std::endl;
+        for (departureNumber = 0; departureNumber < 3; departureNumber++) {
+            if (departureNumber == 0) service = parser.getFirstDeparture();
+            else if (departureNumber == 1) service = parser.getSecondDeparture();
+            else service = parser.getThirdDeparture();
+            if (service == 999) {
+                std::cout << "Departure " << departureNumber + 1 << ": none found" << std::endl;
+            } else {
+                std::cout << "Departure " << departureNumber + 1 << ": Platform " << parser.getPlatform(service) << " at " << parser.getScheduledDepartureTime(service) << " to " << parser.getDestination(service) << " (" << parser.getOperator(service) << ")" << std::endl;
+            }
+        }
+        parser.unsetServiceFilter();
+    }
+    
+    if (!destinations.empty()) {
+        std::cout << "==========================================================" << std::endl;
+        std::cout << "=========== Testing local destination filter =============" << std::endl;
+        std::string crs;
+        std::stringstream ss(destinations);
+        while (std::getline(ss, crs, ',')) {
+            std::vector<size_t> calling = parser.getServicesCallingAt(crs);
+            std::cout << "Services calling at " << crs << ":";
+            for (size_t index : calling) {
+                std::cout << " " << index;
+            }
+            std::cout << std::endl;
+        }
+        parser.setDestinationFilter(destinations);
+        parser.findServices();
+        std::cout << "First three departures" << std::endl;
+        for (departureNumber = 0; departureNumber < 3; departureNumber++) {
+            if (departureNumber == 0) service = parser.getFirstDeparture();
+            else if (departureNumber == 1) service = parser.getSecondDeparture();
+            else service = parser.getThirdDeparture();
+            if (service == 999) {
+                std::cout << "Departure " << departureNumber + 1 << ": none found" << std::endl;
+            } else {
+                std::cout << "Departure " << departureNumber + 1 << ": Platform " << parser.getPlatform(service) << " at " << parser.getScheduledDepartureTime(service) << " to " << parser.getDestination(service) << std::endl;
+            }
+        }
+        parser.unsetDestinationFilter();
+    }
+    
+    if (!snapshot_file.empty()) {
+        std::cout << "==========================================================" << std::endl;
+        std::cout << "=========== Testing board snapshot =======================" << std::endl;
+        TrainServiceParser snapshot_parser;
+        
+        auto start = std::chrono::steady_clock::now();
+        try {
+            snapshot_parser.loadSnapshot(snapshot_file);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+        auto load_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        
+        start = std::chrono::steady_clock::now();
+        TrainServiceParser json_parser;
+        json_parser.updateData(data);
+        auto parse_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        
+        std::cout << "Snapshot load: " << load_us << "us  JSON parse: " << parse_us << "us" << std::endl;
+        std::cout << "Services: " << snapshot_parser.getNumberOfServices() << " (JSON " << parser.getNumberOfServices() << ")" << std::endl;
+        std::cout << "Location: " << snapshot_parser.getLocationName() << std::endl;
+        
+        // Every service should come back exactly as parsed
+        size_t mismatches = 0;
+        parser.setShowCallingPointETD(true);
+        snapshot_parser.setShowCallingPointETD(true);
+        for (i = 0; i < parser.getNumberOfServices() && i < snapshot_parser.getNumberOfServices(); i++) {
+            if (snapshot_parser.getBasicServiceInfo(i) != parser.getBasicServiceInfo(i) ||
+                snapshot_parser.getCallingPoints(i) != parser.getCallingPoints(i) ||
+                snapshot_parser.getDelayReason(i) != parser.getDelayReason(i) ||
+                snapshot_parser.getCancelReason(i) != parser.getCancelReason(i)) {
+                std::cout << "Service " << i << " differs after loading the snapshot" << std::endl;
+                mismatches++;
+            }
+        }
+        if (snapshot_parser.getNrccMessages() != parser.getNrccMessages()) {
+            std::cout << "NRCC messages differ after loading the snapshot" << std::endl;
+            mismatches++;
+        }
+        std::cout << (mismatches == 0 ? "Snapshot matches the parsed data" : "Snapshot does NOT match the parsed data") << std::endl;
+    }
+    
     std::cout << "==========================================================" << std::endl;
     std::cout << "====================== Location ==========================" << std::endl;
     std::cout << parser.getLocationName() << std::endl << std::endl;
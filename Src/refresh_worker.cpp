@@ -0,0 +1,90 @@
+// Train Display - an RGB matrix departure board for the Raspberry Pi
+// Refresh worker
+// Version 1.0
+// Instructions, fixes and issues at https://github.com/jonmorrissmith/RGB_Matrix_Train_Departure_Board
+//
+#include "refresh_worker.h"
+
+RefreshWorker::RefreshWorker(const TrainAPIClient& client, const std::string& from, const std::string& to,
+                             int interval_seconds, DataHandler handler)
+    : api_client(client),
+      on_data(handler),
+      interval(interval_seconds),
+      schedule(nullptr),
+      station_from(from),
+      station_to(to),
+      refresh_requested(false),
+      stopping(false),
+      refreshes(0) {
+}
+
+RefreshWorker::~RefreshWorker() {
+    stop();
+}
+
+void RefreshWorker::start(ThreadSchedule* thread_schedule) {
+    if (worker.joinable()) {
+        return;
+    }
+    schedule = thread_schedule;
+    stopping.store(false);
+    worker = std::thread(&RefreshWorker::run, this);
+}
+
+void RefreshWorker::requestRefresh() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        refresh_requested = true;
+    }
+    wake.notify_one();
+}
+
+void RefreshWorker::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping.store(true);
+    }
+    wake.notify_one();
+    if (worker.joinable()) {
+        worker.join();
+        DEBUG_PRINT("Refresh worker stopped after " << refreshes.load() << " refreshes");
+    }
+}
+
+void RefreshWorker::run() {
+    if (schedule) {
+        schedule->apply();
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    auto next_refresh = std::chrono::steady_clock::now() + interval;
+
+    while (!stopping.load()) {
+        // Sleep until the next refresh is due - or we're asked for one, or to stop
+        if (!wake.wait_until(lock, next_refresh, [this] { return stopping.load() || refresh_requested; }) && schedule) {
+            schedule->recordWake(std::chrono::steady_clock::now() - next_refresh);
+        }
+        if (stopping.load()) {
+            break;
+        }
+        refresh_requested = false;
+        auto started = std::chrono::steady_clock::now();
+        lock.unlock();
+
+        try {
+            std::string payload = api_client.fetchDepartures(station_from, station_to, &stopping);
+            on_data(payload);
+            refreshes.fetch_add(1);
+        } catch (const std::exception& e) {
+            if (!stopping.load()) {
+                std::cerr << "Error refreshing data in background thread: " << e.what() << std::endl;
+            }
+        }
+
+        lock.lock();
+        refresh_requested = false;      // Asked for during this refresh - its data is just as new
+        next_refresh = started + interval;
+    }
+    if (schedule) {
+        schedule->finished();
+    }
+}
@@ -0,0 +1,80 @@
+// Train Display - an RGB matrix departure board for the Raspberry Pi
+// Refresh worker
+// Version 1.0
+// Instructions, fixes and issues at https://github.com/jonmorrissmith/RGB_Matrix_Train_Departure_Board
+//
+// One long-lived thread that polls the API. It sleeps on a condition variable until the next refresh is due
+// (or it's woken early), fetches the departures and hands the payload to a handler on the same thread.
+//
+// Shutdown is bounded: stop() wakes the thread and any API call in flight is aborted, so stop() returns
+// within about a second plus however long the handler takes to finish the board it's working on.
+//
+#ifndef REFRESH_WORKER_H
+#define REFRESH_WORKER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "api_client.h"
+#include "thread_schedule.h"
+
+class RefreshWorker {
+public:
+    // Called on the worker thread with each payload fetched - exceptions are caught and logged
+    typedef std::function<void(const std::string& payload)> DataHandler;
+
+    /**
+     * @param client The API client - the worker keeps its own copy
+     * @param from Departure station code
+     * @param to Destination station code (empty for all destinations)
+     * @param interval_seconds Time between the start of one refresh and the start of the next
+     * @param handler Called with each payload fetched
+     */
+    RefreshWorker(const TrainAPIClient& client, const std::string& from, const std::string& to,
+                  int interval_seconds, DataHandler handler);
+    ~RefreshWorker();
+
+    RefreshWorker(const RefreshWorker&) = delete;
+    RefreshWorker& operator=(const RefreshWorker&) = delete;
+
+    /**
+     * Start the worker thread - the first refresh is one interval from now
+     * @param thread_schedule Scheduling for the thread, applied by the thread itself (nullptr to leave it alone)
+     */
+    void start(ThreadSchedule* thread_schedule = nullptr);
+
+    /**
+     * Refresh now rather than waiting for the next interval
+     * Does nothing if a refresh is already in progress (its data is just as new)
+     */
+    void requestRefresh();
+
+    /**
+     * Stop the worker and wait for it - an API call in flight is aborted
+     * Safe to call more than once
+     */
+    void stop();
+
+private:
+    TrainAPIClient api_client;
+    DataHandler on_data;
+    std::chrono::seconds interval;
+
+    std::thread worker;
+    ThreadSchedule* schedule;
+    std::mutex mutex;                   // Guards refresh_requested
+    std::condition_variable wake;
+    const std::string station_from;
+    const std::string station_to;
+    bool refresh_requested;
+    std::atomic<bool> stopping;         // Also aborts an API call in flight
+    std::atomic<uint64_t> refreshes;    // Successful refreshes, for the debug output
+
+    void run();
+};
+
+#endif // REFRESH_WORKER_H
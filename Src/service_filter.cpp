@@ -0,0 +1,221 @@
+// Train Display - an RGB matrix departure board for the Raspberry Pi
+// Departure filter expressions
+// Version 1.0
+// Instructions, fixes and issues at https://github.com/jonmorrissmith/RGB_Matrix_Train_Departure_Board
+//
+#include "service_filter.h"
+#include <cctype>
+
+namespace {
+
+// Tokens of the filter language
+enum TokenType { WORD, STRING, EQUALS, NOT_EQUALS, OPEN_SET, CLOSE_SET, COMMA, END };
+
+struct Token {
+    TokenType type;
+    std::string text;
+};
+
+std::vector<Token> tokenise(const std::string& expression) {
+    std::vector<Token> tokens;
+    size_t i = 0;
+
+    while (i < expression.length()) {
+        char c = expression[i];
+
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            i++;
+        } else if (c == '{') {
+            tokens.push_back({OPEN_SET, "{"});
+            i++;
+        } else if (c == '}') {
+            tokens.push_back({CLOSE_SET, "}"});
+            i++;
+        } else if (c == ',') {
+            tokens.push_back({COMMA, ","});
+            i++;
+        } else if (c == '=') {
+            // Accept both '=' and '=='
+            i += (i + 1 < expression.length() && expression[i + 1] == '=') ? 2 : 1;
+            tokens.push_back({EQUALS, "="});
+        } else if (c == '!' && i + 1 < expression.length() && expression[i + 1] == '=') {
+            tokens.push_back({NOT_EQUALS, "!="});
+            i += 2;
+        } else if (c == '"') {
+            size_t end = expression.find('"', i + 1);
+            if (end == std::string::npos) {
+                throw std::runtime_error("Unterminated string in filter: " + expression);
+            }
+            tokens.push_back({STRING, expression.substr(i + 1, end - i - 1)});
+            i = end + 1;
+        } else if (std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '-' || c == '.') {
+            size_t start = i;
+            while (i < expression.length() &&
+                   (std::isalnum(static_cast<unsigned char>(expression[i])) ||
+                    expression[i] == '_' || expression[i] == '-' || expression[i] == '.')) {
+                i++;
+            }
+            tokens.push_back({WORD, expression.substr(start, i - start)});
+        } else {
+            throw std::runtime_error("Unexpected character '" + std::string(1, c) + "' in filter: " + expression);
+        }
+    }
+    tokens.push_back({END, ""});
+    return tokens;
+}
+
+std::string lower(std::string str) {
+    for (auto& c : str) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return str;
+}
+
+} // namespace
+
+ServiceFilter::ServiceFilter(const std::string& expression) : expression_text(expression) {
+    std::vector<Token> tokens = tokenise(expression);
+    size_t pos = 0;
+
+    auto fail = [&](const std::string& reason) {
+        throw std::runtime_error("Invalid filter (" + reason + "): " + expression);
+    };
+
+    auto isKeyword = [&](const char* keyword) {
+        return tokens[pos].type == WORD && lower(tokens[pos].text) == keyword;
+    };
+
+    clauses.emplace_back();
+
+    while (true) {
+        Term term;
+        term.negate = false;
+
+        // Any number of leading 'not's
+        while (isKeyword("not")) {
+            term.negate = !term.negate;
+            pos++;
+        }
+
+        if (tokens[pos].type != WORD) fail("expected a field name");
+        std::string field = lower(tokens[pos].text);
+        pos++;
+
+        if (field == "cancelled" || field == "delayed") {
+            term.field = (field == "cancelled") ? CANCELLED : DELAYED;
+        } else {
+            if (field == "platform") {
+                term.field = PLATFORM;
+            } else if (field == "operator") {
+                term.field = OPERATOR;
+            } else if (field == "destination") {
+                term.field = DESTINATION;
+            } else if (field == "calls_at") {
+                term.field = CALLS_AT;
+            } else {
+                fail("unknown field '" + field + "'");
+            }
+
+            // Comparison - '=', '!=' or 'in {...}'
+            if (tokens[pos].type == EQUALS || tokens[pos].type == NOT_EQUALS) {
+                if (tokens[pos].type == NOT_EQUALS) term.negate = !term.negate;
+                pos++;
+                if (tokens[pos].type != WORD && tokens[pos].type != STRING) fail("expected a value after '" + field + "'");
+                term.values.push_back(tokens[pos].text);
+                pos++;
+            } else if (isKeyword("in")) {
+                pos++;
+                if (tokens[pos].type != OPEN_SET) fail("expected '{' after 'in'");
+                pos++;
+                while (tokens[pos].type == WORD || tokens[pos].type == STRING) {
+                    term.values.push_back(tokens[pos].text);
+                    pos++;
+                    if (tokens[pos].type != COMMA) break;
+                    pos++;
+                }
+                if (tokens[pos].type != CLOSE_SET) fail("expected '}' to close the set");
+                if (term.values.empty()) fail("empty set");
+                pos++;
+            } else {
+                fail("expected '=', '!=' or 'in' after '" + field + "'");
+            }
+        }
+
+        clauses.back().push_back(term);
+
+        if (tokens[pos].type == END) break;
+        if (isKeyword("and")) {
+            pos++;
+        } else if (isKeyword("or")) {
+            clauses.emplace_back();
+            pos++;
+        } else {
+            fail("expected 'and' or 'or' before '" + tokens[pos].text + "'");
+        }
+    }
+
+    DEBUG_PRINT("Compiled filter '" << expression << "' into " << clauses.size() << " alternative(s)");
+}
+
+bool ServiceFilter::matches(const TrainServiceParser::TrainServiceInfo& service) const {
+    for (const auto& clause : clauses) {
+        bool all_match = true;
+        for (const auto& term : clause) {
+            if (!termMatches(term, service)) {
+                all_match = false;
+                break;
+            }
+        }
+        if (all_match) return true;
+    }
+    return false;
+}
+
+bool ServiceFilter::termMatches(const Term& term, const TrainServiceParser::TrainServiceInfo& service) const {
+    bool result = false;
+
+    switch (term.field) {
+        case PLATFORM:
+            result = valueMatches(term.values, service.platform);
+            break;
+        case OPERATOR:
+            result = valueMatches(term.values, service.operator_raw) || valueMatches(term.values, service.operatorCode);
+            break;
+        case DESTINATION:
+            result = valueMatches(term.values, service.destination) || valueMatches(term.values, service.destinationCRS);
+            break;
+        case CALLS_AT:
+            for (const auto& calling_point : service.callingPointList) {
+                if (valueMatches(term.values, calling_point.crs) || valueMatches(term.values, calling_point.locationName)) {
+                    result = true;
+                    break;
+                }
+            }
+            break;
+        case CANCELLED:
+            result = service.isCancelled;
+            break;
+        case DELAYED:
+            result = service.isDelayed;
+            break;
+    }
+
+    return term.negate ? !result : result;
+}
+
+bool ServiceFilter::equalsIgnoreCase(const std::string& a, const std::string& b) {
+    if (a.length() != b.length()) return false;
+    for (size_t i = 0; i < a.length(); i++) {
+        if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ServiceFilter::valueMatches(const std::vector<std::string>& values, const std::string& text) {
+    for (const auto& value : values) {
+        if (equalsIgnoreCase(value, text)) return true;
+    }
+    return false;
+}
@@ -0,0 +1,71 @@
+// Train Display - an RGB matrix departure board for the Raspberry Pi
+// Departure filter expressions
+// Version 1.0
+// Instructions, fixes and issues at https://github.com/jonmorrissmith/RGB_Matrix_Train_Departure_Board
+//
+// A small filter language, set with 'filter=' in config.txt, to choose which departures are shown.
+// The expression is compiled once and then evaluated against each parsed service.
+//
+// Fields:
+//   platform, operator, destination, calls_at    compared with  =  !=  in {a, b, ...}
+//   cancelled, delayed                           used on their own
+//
+// Terms are combined with 'and', 'or' and 'not' ('and' binds tighter than 'or').
+// Values containing spaces must be in double quotes.  Text comparisons ignore case.
+//
+// Examples:
+//   platform in {1, 2}
+//   operator != "Thameslink" and not cancelled
+//   calls_at = SVG or destination = "Cambridge"
+//
+#ifndef SERVICE_FILTER_H
+#define SERVICE_FILTER_H
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include "train_service_parser.h"
+
+class ServiceFilter {
+public:
+    ServiceFilter() = default;
+
+    /**
+     * Compile a filter expression
+     * @param expression The filter expression (see the top of this file)
+     * @throws std::runtime_error if the expression is not valid
+     */
+    explicit ServiceFilter(const std::string& expression);
+
+    /**
+     * Evaluate the compiled filter against a service
+     * @param service The service to test
+     * @return true if the service should be shown
+     */
+    bool matches(const TrainServiceParser::TrainServiceInfo& service) const;
+
+    /**
+     * The expression this filter was compiled from
+     * @return The original filter expression
+     */
+    const std::string& getExpression() const { return expression_text; }
+
+private:
+    enum Field { PLATFORM, OPERATOR, DESTINATION, CALLS_AT, CANCELLED, DELAYED };
+
+    struct Term {
+        Field field;
+        bool negate;
+        std::vector<std::string> values;   // Any of these values is a match (empty for cancelled/delayed)
+    };
+
+    // Compiled expression - a list of alternatives ('or'), each a list of terms which must all match ('and')
+    std::vector<std::vector<Term>> clauses;
+    std::string expression_text;
+
+    bool termMatches(const Term& term, const TrainServiceParser::TrainServiceInfo& service) const;
+    static bool equalsIgnoreCase(const std::string& a, const std::string& b);
+    static bool valueMatches(const std::vector<std::string>& values, const std::string& text);
+};
+
+#endif // SERVICE_FILTER_H
@@ -0,0 +1,78 @@
+// Train Display - an RGB matrix departure board for the Raspberry Pi
+// Text scroller
+// Version 1.0
+// Instructions, fixes and issues at https://github.com/jonmorrissmith/RGB_Matrix_Train_Departure_Board
+//
+#include "text_scroller.h"
+
+namespace {
+
+const int64_t NANOSECONDS_PER_SECOND = 1000000000;
+const int64_t ONE_PIXEL = int64_t(1) << TextScroller::FRACTION_BITS;
+const int64_t MAX_STEP = 10 * NANOSECONDS_PER_SECOND;     // Longest gap moved in one go - keeps speed x elapsed well inside 64 bits
+
+} // namespace
+
+TextScroller::TextScroller(int pixels_per_second) : position(0), carry(0) {
+    setSpeed(pixels_per_second);
+    last_update = std::chrono::steady_clock::now();
+}
+
+void TextScroller::setSpeed(int pixels_per_second) {
+    speed = static_cast<int64_t>(pixels_per_second < 1 ? 1 : pixels_per_second) << FRACTION_BITS;
+}
+
+void TextScroller::moveTo(int x, std::chrono::steady_clock::time_point now) {
+    position = static_cast<int64_t>(x) * ONE_PIXEL;
+    carry = 0;
+    last_update = now;
+}
+
+void TextScroller::hold(std::chrono::steady_clock::time_point now) {
+    last_update = now;
+}
+
+bool TextScroller::advance(std::chrono::steady_clock::time_point now, int text_width, int restart_x) {
+    if (now <= last_update) {
+        return false;
+    }
+    int64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - last_update).count();
+    last_update = now;
+    if (elapsed > MAX_STEP) {
+        elapsed = MAX_STEP;
+    }
+
+    // Distance in fixed point units, with the remainder carried forward so nothing is lost to rounding
+    int64_t moved = speed * elapsed + carry;
+    position -= moved / NANOSECONDS_PER_SECOND;
+    carry = moved % NANOSECONDS_PER_SECOND;
+
+    // Wrap once the text is completely off the left - keeping the fraction so the scroll stays smooth
+    bool wrapped = false;
+    int64_t left_limit = -static_cast<int64_t>(text_width) * ONE_PIXEL;
+    if (position < left_limit) {
+        int64_t cycle = (static_cast<int64_t>(restart_x) + text_width) * ONE_PIXEL;
+        if (cycle <= 0) {
+            position = static_cast<int64_t>(restart_x) * ONE_PIXEL;
+        } else {
+            while (position < left_limit) {
+                position += cycle;
+            }
+        }
+        wrapped = true;
+    }
+    return wrapped;
+}
+
+int TextScroller::x() const {
+    // Round up (towards where the text came from), so every pixel position is shown for a whole pixel of travel
+    return static_cast<int>(position >= 0 ? (position + ONE_PIXEL - 1) / ONE_PIXEL : -((-position) / ONE_PIXEL));
+}
+
+std::chrono::steady_clock::duration TextScroller::untilNextPixel() const {
+    // Fixed point units to move before x() drops by one, less what's already been carried
+    int64_t remaining = position - static_cast<int64_t>(x() - 1) * ONE_PIXEL;
+    int64_t needed = remaining * NANOSECONDS_PER_SECOND - carry;
+    int64_t nanoseconds = (needed + speed - 1) / speed;
+    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(nanoseconds));
+}
@@ -0,0 +1,74 @@
+// Train Display - an RGB matrix departure board for the Raspberry Pi
+// Text scroller
+// Version 1.0
+// Instructions, fixes and issues at https://github.com/jonmorrissmith/RGB_Matrix_Train_Departure_Board
+//
+// The position of a horizontally scrolling line of text, moved on by the time that has passed rather than
+// by a pixel per frame - so the scroll runs at the same speed however often (or late) the frames are drawn.
+//
+// The position is kept in fixed point (1/256 of a pixel) and the time left over from each step is carried to
+// the next, so there's no drift however long the display runs.
+//
+#ifndef TEXT_SCROLLER_H
+#define TEXT_SCROLLER_H
+
+#include <chrono>
+#include <cstdint>
+
+class TextScroller {
+public:
+    static const int FRACTION_BITS = 8;                     // Fixed point - 1/256 of a pixel
+
+    /**
+     * @param pixels_per_second Scroll speed
+     */
+    explicit TextScroller(int pixels_per_second = 60);
+
+    /**
+     * Set the scroll speed - anything under 1 pixel per second is treated as 1
+     * @param pixels_per_second Scroll speed
+     */
+    void setSpeed(int pixels_per_second);
+    int getSpeed() const { return static_cast<int>(speed >> FRACTION_BITS); }
+
+    /**
+     * Jump to a position - the scroll moves on from here at the next advance()
+     * @param x Position in whole pixels
+     * @param now The time the text is at x
+     */
+    void moveTo(int x, std::chrono::steady_clock::time_point now);
+
+    /**
+     * Stay where we are until now - used when a scroll restarts after being stopped, so it doesn't jump
+     * @param now The time the scroll restarts
+     */
+    void hold(std::chrono::steady_clock::time_point now);
+
+    /**
+     * Move the text left by the time passed since the last call
+     * When the text has scrolled completely off the left edge it continues from restart_x
+     * @param now The time to move to
+     * @param text_width Width of the text in pixels
+     * @param restart_x Where the text re-enters (normally the right edge of the display)
+     * @return true if the text wrapped round (a pass is complete)
+     */
+    bool advance(std::chrono::steady_clock::time_point now, int text_width, int restart_x);
+
+    /**
+     * @return The position in whole pixels (rounded towards the right)
+     */
+    int x() const;
+
+    /**
+     * @return How long until x() next changes at this speed
+     */
+    std::chrono::steady_clock::duration untilNextPixel() const;
+
+private:
+    int64_t speed;                                          // Fixed point pixels per second
+    int64_t position;                                       // Fixed point x position
+    int64_t carry;                                          // Fixed point units x 1e9 not yet moved (the sub-unit remainder)
+    std::chrono::steady_clock::time_point last_update;
+};
+
+#endif // TEXT_SCROLLER_H
@@ -0,0 +1,80 @@
+// Train Display - an RGB matrix departure board for the Raspberry Pi
+// Text strip
+// Version 1.0
+// Instructions, fixes and issues at https://github.com/jonmorrissmith/RGB_Matrix_Train_Departure_Board
+//
+#include "text_strip.h"
+#include <algorithm>
+
+namespace {
+
+// A canvas that sets bits in a strip - for text without a glyph table
+class BitCanvas : public rgb_matrix::Canvas {
+public:
+    BitCanvas(int w, int h, int words, std::vector<uint32_t>& b) : canvas_width(w), canvas_height(h), words_per_row(words), bits(b) {}
+
+    int width() const override { return canvas_width; }
+    int height() const override { return canvas_height; }
+    void SetPixel(int x, int y, uint8_t red, uint8_t green, uint8_t blue) override {
+        if (x < 0 || y < 0 || x >= canvas_width || y >= canvas_height || (red | green | blue) == 0) {
+            return;
+        }
+        bits[static_cast<size_t>(y) * words_per_row + (x >> 5)] |= 1u << (x & 31);
+    }
+    void Clear() override { std::fill(bits.begin(), bits.end(), 0); }
+    void Fill(uint8_t red, uint8_t green, uint8_t blue) override {
+        std::fill(bits.begin(), bits.end(), (red | green | blue) ? ~0u : 0u);
+    }
+
+private:
+    int canvas_width;
+    int canvas_height;
+    int words_per_row;
+    std::vector<uint32_t>& bits;
+};
+
+} // namespace
+
+TextStrip::TextStrip() : strip_width(0), strip_height(0), baseline(0), words_per_row(0) {
+}
+
+void TextStrip::render(const GlyphAtlas& font, const DisplayText& text) {
+    strip_width = text.text.empty() || text.width < 0 ? 0 : text.width;
+    strip_height = font.height() > 0 ? font.height() : 0;
+    baseline = font.baseline();
+    words_per_row = (strip_width + 31) / 32;
+    bits.assign(static_cast<size_t>(words_per_row) * strip_height, 0);
+    if (strip_width == 0 || strip_height == 0) {
+        strip_width = 0;
+        return;
+    }
+
+    if (text.glyph_offsets.size() == text.glyphs.size() + 1) {
+        // Glyph rows are ORed straight into the strip a word at a time
+        for (size_t i = 0; i < text.glyphs.size(); i++) {
+            font.blitGlyph(bits.data(), words_per_row, strip_width, strip_height, text.glyph_offsets[i], baseline, text.glyphs[i]);
+        }
+        return;
+    }
+    BitCanvas canvas(strip_width, strip_height, words_per_row, bits);
+    text.draw(&canvas, font, 0, baseline, rgb_matrix::Color(255, 255, 255), 0, strip_width);
+}
+
+void TextStrip::draw(rgb_matrix::Canvas* target, int x, int baseline_y, const Rect& clip, const rgb_matrix::Color& color) const {
+    if (empty()) {
+        return;
+    }
+    // Only the part of the strip that lands inside the clip rectangle
+    Rect visible = clip.intersect(Rect(x, baseline_y - baseline, strip_width, strip_height));
+    if (visible.empty()) {
+        return;
+    }
+    int top = baseline_y - baseline;
+    for (int y = visible.y; y < visible.y + visible.height; y++) {
+        for (int column = visible.x; column < visible.x + visible.width; column++) {
+            if (pixel(column - x, y - top)) {
+                target->SetPixel(column, y, color.r, color.g, color.b);
+            }
+        }
+    }
+}
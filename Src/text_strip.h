@@ -0,0 +1,59 @@
+// Train Display - an RGB matrix departure board for the Raspberry Pi
+// Text strip
+// Version 1.0
+// Instructions, fixes and issues at https://github.com/jonmorrissmith/RGB_Matrix_Train_Departure_Board
+//
+// A line of text rendered once into a 1-bit bitmap, one bit per pixel, the height of the font and the
+// width of the text.
+//
+// Scrolling text is drawn from the strip rather than with DrawText: only the columns that are visible are
+// copied to the canvas, so drawing a frame costs the same for a long NRCC message as for a short one.
+//
+#ifndef TEXT_STRIP_H
+#define TEXT_STRIP_H
+
+#include <graphics.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "damage_tracker.h"
+#include "display_text.h"
+
+class TextStrip {
+public:
+    TextStrip();
+
+    /**
+     * Render text into the strip, replacing anything already there
+     * @param font The font to render with
+     * @param text The text - drawn from its glyph table, so it's decoded and normalised as it was measured
+     */
+    void render(const GlyphAtlas& font, const DisplayText& text);
+
+    int width() const { return strip_width; }
+    int height() const { return strip_height; }
+    bool empty() const { return strip_width == 0; }
+
+    /**
+     * Copy the visible part of the strip to a canvas
+     * @param target The canvas to draw into
+     * @param x Where the left of the text is
+     * @param baseline_y The baseline of the line of text (as for DrawText)
+     * @param clip Only pixels inside this rectangle are drawn
+     * @param color Colour of the text
+     */
+    void draw(rgb_matrix::Canvas* target, int x, int baseline_y, const Rect& clip, const rgb_matrix::Color& color) const;
+
+private:
+    int strip_width;
+    int strip_height;
+    int baseline;                                           // Font baseline - rows above it in the strip
+    int words_per_row;
+    std::vector<uint32_t> bits;                             // Row by row, bit x%32 of word x/32 is column x
+
+    bool pixel(int x, int y) const {
+        return (bits[static_cast<size_t>(y) * words_per_row + (x >> 5)] >> (x & 31)) & 1u;
+    }
+};
+
+#endif // TEXT_STRIP_H
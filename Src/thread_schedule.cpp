@@ -0,0 +1,159 @@
+// Train Display - an RGB matrix departure board for the Raspberry Pi
+// Thread scheduling
+// Version 1.0
+// Instructions, fixes and issues at https://github.com/jonmorrissmith/RGB_Matrix_Train_Departure_Board
+//
+#include "thread_schedule.h"
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+ThreadSchedule::ThreadSchedule(const std::string& name, int fifo_priority, const std::string& cpus)
+    : thread_name(name),
+      priority(fifo_priority),
+      cpu_list(cpus),
+      has_cpus(!cpus.empty()),
+      tid(0),
+      running(false) {
+    if (priority < 0 || priority > MAX_PRIORITY) {
+        throw std::runtime_error("Invalid " + thread_name + " thread priority " + std::to_string(priority) +
+                                 " - 0 for normal scheduling, 1 to " + std::to_string(MAX_PRIORITY) + " for SCHED_FIFO");
+    }
+    CPU_ZERO(&cpu_set);
+    if (has_cpus && !parseCpus(cpus, cpu_set)) {
+        throw std::runtime_error("Invalid " + thread_name + " thread CPU list: " + cpus);
+    }
+}
+
+// "0-2,3" style - CPU numbers and ranges, comma separated
+bool ThreadSchedule::parseCpus(const std::string& cpus, cpu_set_t& set) {
+    std::stringstream list(cpus);
+    std::string item;
+    bool any = false;
+    while (std::getline(list, item, ',')) {
+        int first = 0;
+        int last = 0;
+        char dash = 0;
+        std::stringstream range(item);
+        if (!(range >> first)) {
+            return false;
+        }
+        last = first;
+        if (range >> dash) {
+            if (dash != '-' || !(range >> last)) {
+                return false;
+            }
+        }
+        std::string rest;
+        if (range >> rest || first < 0 || last < first || last >= CPU_SETSIZE) {
+            return false;
+        }
+        for (int cpu = first; cpu <= last; cpu++) {
+            CPU_SET(cpu, &set);
+        }
+        any = true;
+    }
+    return any;
+}
+
+bool ThreadSchedule::apply() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tid = static_cast<pid_t>(syscall(SYS_gettid));
+        running = true;
+    }
+
+    bool applied = true;
+    if (has_cpus) {
+        int error = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+        if (error != 0) {
+            std::cerr << "Could not run the " << thread_name << " thread on CPUs " << cpu_list << ": " << strerror(error) << std::endl;
+            applied = false;
+        }
+    }
+    if (priority > 0) {
+        sched_param param;
+        param.sched_priority = priority;
+        int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (error != 0) {
+            std::cerr << "Could not set the " << thread_name << " thread to SCHED_FIFO priority " << priority << ": "
+                      << strerror(error) << (error == EPERM ? " (needs root - see led-no-drop-privs)" : "") << std::endl;
+            applied = false;
+        }
+    }
+    return applied;
+}
+
+void ThreadSchedule::recordWake(std::chrono::steady_clock::duration late) {
+    std::lock_guard<std::mutex> lock(mutex);
+    wake_latency.record(late);
+}
+
+void ThreadSchedule::finished() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (running) {
+        final_counters = readCounters(tid);
+        running = false;
+    }
+}
+
+ThreadSchedule::Counters ThreadSchedule::readCounters(pid_t thread_id) {
+    Counters counters;
+    std::string task = "/proc/self/task/" + std::to_string(thread_id);
+
+    std::ifstream status(task + "/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        std::stringstream fields(line);
+        std::string key;
+        uint64_t value = 0;
+        if (!(fields >> key >> value)) {
+            continue;
+        }
+        if (key == "voluntary_ctxt_switches:") {
+            counters.voluntary_switches = value;
+            counters.have_switches = true;
+        } else if (key == "nonvoluntary_ctxt_switches:") {
+            counters.involuntary_switches = value;
+        }
+    }
+
+    // Time on the CPU, time waiting to run, and the number of timeslices - all in nanoseconds since the thread started
+    std::ifstream schedstat(task + "/schedstat");
+    uint64_t on_cpu_ns = 0;
+    if (schedstat >> on_cpu_ns >> counters.run_delay_ns >> counters.timeslices) {
+        counters.have_run_delay = true;
+    }
+    return counters;
+}
+
+void ThreadSchedule::writeReport(std::ostream& out) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    out << "thread " << thread_name << ": policy=" << (priority > 0 ? "fifo" : "inherited")
+        << " priority=" << priority
+        << " cpus=" << (has_cpus ? cpu_list : "any");
+    if (tid == 0) {
+        out << " (not started)" << std::endl;
+        return;
+    }
+    Counters counters = running ? readCounters(tid) : final_counters;
+    out << " tid=" << tid;
+    if (counters.have_switches) {
+        out << " voluntary_switches=" << counters.voluntary_switches
+            << " involuntary_switches=" << counters.involuntary_switches;
+    }
+    if (counters.have_run_delay) {
+        out << " run_delay_ms=" << std::fixed << std::setprecision(2) << counters.run_delay_ns / 1e6
+            << " mean_run_delay_us=" << std::setprecision(1)
+            << (counters.timeslices ? counters.run_delay_ns / 1e3 / counters.timeslices : 0.0);
+    }
+    out << std::endl;
+    wake_latency.write(out, thread_name + "_wake_latency");
+}
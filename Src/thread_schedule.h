@@ -0,0 +1,101 @@
+// Train Display - an RGB matrix departure board for the Raspberry Pi
+// Thread scheduling
+// Version 1.0
+// Instructions, fixes and issues at https://github.com/jonmorrissmith/RGB_Matrix_Train_Departure_Board
+//
+// The scheduling policy and CPUs for one of the display's threads - the render loop, the refresh worker or
+// the frame presenter - and how well the thread has been getting the CPU.
+//
+// A priority of 0 leaves the thread as it was started (normally SCHED_OTHER); 1 to 98 runs it SCHED_FIFO at
+// that priority. 99 is left to the matrix library's refresh thread, which on a multi-core Pi is pinned to
+// core 3 - anything else pinned there competes with the panel refresh and shows as flicker.
+//
+// Each thread applies its own settings when it starts. A thread inherits its parent's policy and CPUs, so
+// the render loop starts the other threads before it applies its own.
+//
+// For the report, what each thread has been through is read from /proc/self/task/<tid>:
+//   voluntary/involuntary_switches   context switches from waiting, and from being preempted
+//   run_delay                        time spent runnable but waiting for a CPU (schedstat)
+// and each thread records its wake latency - how late it woke after a timed sleep.
+//
+#ifndef THREAD_SCHEDULE_H
+#define THREAD_SCHEDULE_H
+
+#include <sched.h>
+#include <sys/types.h>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include "frame_pacer.h"
+
+class ThreadSchedule {
+public:
+    static const int MAX_PRIORITY = 98;
+
+    /**
+     * @param thread_name Name of the thread (for messages and the report)
+     * @param fifo_priority 0 to leave the policy alone, or 1 to MAX_PRIORITY for SCHED_FIFO
+     * @param cpus CPUs to run on, e.g. "0-2" or "1,2" - empty for any
+     * @throws std::runtime_error if the priority or CPU list isn't valid
+     */
+    ThreadSchedule(const std::string& thread_name, int fifo_priority, const std::string& cpus);
+
+    ThreadSchedule(const ThreadSchedule&) = delete;
+    ThreadSchedule& operator=(const ThreadSchedule&) = delete;
+
+    /**
+     * Apply the settings to the calling thread, and start reporting on it
+     * Failing to apply them (SCHED_FIFO needs root or an RLIMIT_RTPRIO grant) is reported but not fatal
+     * @return false if a setting couldn't be applied
+     */
+    bool apply();
+
+    // Does the thread's CPU list include a CPU?
+    bool usesCpu(int cpu) const { return has_cpus && CPU_ISSET(cpu, &cpu_set); }
+
+    const std::string& name() const { return thread_name; }
+
+    /**
+     * Record how late the thread woke from a timed sleep
+     * @param late Time between when it asked to wake and when it was running again
+     */
+    void recordWake(std::chrono::steady_clock::duration late);
+
+    // Call on the thread as it finishes - its counters are kept for the report
+    void finished();
+
+    /**
+     * Write what the thread is set to and its scheduling statistics
+     * @param out The stream to write to
+     */
+    void writeReport(std::ostream& out) const;
+
+private:
+    struct Counters {
+        uint64_t voluntary_switches = 0;
+        uint64_t involuntary_switches = 0;
+        uint64_t run_delay_ns = 0;
+        uint64_t timeslices = 0;
+        bool have_switches = false;
+        bool have_run_delay = false;
+    };
+
+    std::string thread_name;
+    int priority;
+    std::string cpu_list;
+    cpu_set_t cpu_set;
+    bool has_cpus;
+
+    mutable std::mutex mutex;                               // The thread records, the render loop reports
+    pid_t tid;                                              // 0 until applied
+    bool running;
+    Counters final_counters;                                // Once the thread has finished
+    TimingHistogram wake_latency;
+
+    static bool parseCpus(const std::string& cpus, cpu_set_t& set);
+    static Counters readCounters(pid_t thread_id);
+};
+
+#endif // THREAD_SCHEDULE_H
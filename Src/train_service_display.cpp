@@ -10,58 +10,75 @@
 //
 
 #include "train_service_display.h"
+#include <fstream>
 
-TrainServiceDisplay::TrainServiceDisplay(RGBMatrix* m, TrainServiceParser& p, TrainAPIClient& ac, const Config& cfg)
-: matrix(m),
+TrainServiceDisplay::TrainServiceDisplay(DisplayBackend& b, TrainServiceParser& p, TrainAPIClient& ac, const Config& cfg)
+: backend(b),
+white(255, 255, 255), black(0, 0, 0),
 parser(p),
-apiClient(ac),
 config(cfg),
+clock_time(0),
+frame_buffer(b.width(), b.height()),
 
 // Set flags from configuration
 show_platforms(cfg.getBool("ShowPlatforms")),
 show_location(cfg.getBool("ShowLocation")),
 show_messages(cfg.getBool("ShowMessages")),
+local_destination_filter(cfg.getBool("local_destination_filter")),
 
 // Set timing from configuration
 ETD_coach_refresh_seconds(cfg.getInt("ETD_coach_refresh_seconds")),
 third_line_refresh_seconds(cfg.getInt("third_line_refresh_seconds")),
 Message_Refresh_interval(cfg.getInt("Message_Refresh_interval")),
-refresh_interval_seconds(cfg.getInt("refresh_interval_seconds")),
+frame_pacer(cfg.getInt("frame_rate")),
+frame_stats_requested(false),
+refresh_requested(false),
+scroll_tick_scheduled(false),
 
-white(255, 255, 255), black(0, 0, 0)
+render_thread("render", cfg.getInt("render_thread_priority"), cfg.get("render_thread_cpus")),
+refresh_thread("refresh", cfg.getInt("refresh_thread_priority"), cfg.get("refresh_thread_cpus")),
+presenter_thread("presenter", cfg.getInt("presenter_thread_priority"), cfg.get("presenter_thread_cpus")),
+
+// If the destination is filtered locally then fetch departures for all destinations
+refresh_worker(ac, cfg.get("from"), cfg.getBool("local_destination_filter") ? "" : cfg.get("to"),
+               cfg.getInt("refresh_interval_seconds"),
+               [this](const std::string& payload) { refreshData(payload); })
 {
     // We're up and running!
     running = true;
     
-    // Load and cache the font
-    if (!font.LoadFont(config.get("fontPath").c_str())) {
-        throw std::runtime_error("Font loading failed for: " + config.get("fontPath"));
-    }
+    // Load and cache the font - from the glyph atlas cache once it's been built
+    font.open(config.get("fontPath"), config.get("font_atlas_path"));
     font_cache.setFont(font);
     font_baseline = font_cache.getBaseline();
     font_height = font_cache.getheight();
     
     // Cache matrix parameters
-    matrix_width = m->width();
-    matrix_height = m->height();
-    canvas = m->CreateFrameCanvas();
+    matrix_width = backend.width();
+    matrix_height = backend.height();
     
-    // Initialize text y positions
-    first_departure.y_position = config.getInt("first_line_y");
-    first_departure_coaches.y_position = config.getInt("first_line_y");
-    first_departure_etd.y_position = config.getInt("first_line_y");
+    // Frames are shown from a thread of their own if there's a queue for them
+    if (config.getInt("frame_queue_depth") > 0) {
+        presenter.reset(new FramePresenter(backend, frame_pacer, config.getInt("frame_queue_depth")));
+    }
     
-    calling_points_text.y_position = config.getInt("second_line_y");
-    calling_at_text.y_position = config.getInt("second_line_y");
+    // Our threads can share the panel refresh thread's core, but it's worth knowing about
+    int refresh_cpu = backend.refreshCpu();
+    for (const ThreadSchedule* thread : {&render_thread, &refresh_thread, &presenter_thread}) {
+        if (refresh_cpu >= 0 && thread->usesCpu(refresh_cpu)) {
+            std::cerr << "Warning: the " << thread->name() << " thread can run on CPU " << refresh_cpu
+                      << ", which the matrix library's refresh thread is pinned to - expect flicker" << std::endl;
+        }
+    }
     
-    second_departure.y_position = config.getInt("third_line_y");
-    second_departure_etd.y_position = config.getInt("third_line_y");
-    third_departure.y_position= config.getInt("third_line_y");
-    third_departure_etd.y_position= config.getInt("third_line_y");
+    // Initialize text y positions
+    first_line_y = config.getInt("first_line_y");
+    second_line_y = config.getInt("second_line_y");
+    third_line_y = config.getInt("third_line_y");
+    fourth_line_y = config.getInt("fourth_line_y");
     
-    clock_display_text.y_position = config.getInt("fourth_line_y");
-    nrcc_message_text.y_position = config.getInt("fourth_line_y");
-    location_name_text.y_position = config.getInt("fourth_line_y");
+    calling_at_text.y_position = second_line_y;
+    clock_display_text.y_position = fourth_line_y;
     
     // Set parser options from config
     // Are calling points ETD's being shown?
@@ -72,97 +89,107 @@ white(255, 255, 255), black(0, 0, 0)
         parser.setSelectedPlatform(config.get("platform"));
     }
     
-    // Get location name
-    location_name_text = "";
-    // If we're showing the location then get the width and calculate the x position to centre on the display
-    if (show_location) {
-        location_name_text.setTextAndWidth(parser.getLocationName(), font_cache);
-        location_name_text.x_position = (matrix_width - location_name_text.width)/2;
+    // Is the destination being filtered locally (rather than by the API call)?
+    if(local_destination_filter && !config.get("to").empty()){
+        parser.setDestinationFilter(config.get("to"));
+    }
+    
+    // Has a filter been set? This throws if the filter expression is invalid
+    if(!config.get("filter").empty()){
+        parser.setServiceFilter(config.get("filter"));
     }
     
     // Initialise scrolling positions
     // Initialize scrolling-text x positions to the far right of the display
-    calling_points_text.x_position = matrix_width;
-    nrcc_message_text.x_position = matrix_width;
-    // Initialise 2nd/3rd departure baseline (this is a vertical scroll)
-    baseline_2nd_3rd_departure_scroll = second_departure.y_position;
+    // Scroll speeds are in pixels per second, so they don't depend on how fast frames are drawn
+    calling_points_scroll.setSpeed(config.getInt("calling_points_scroll_speed"));
+    nrcc_message_scroll.setSpeed(config.getInt("message_scroll_speed"));
+    calling_points_scroll.moveTo(matrix_width, std::chrono::steady_clock::now());
+    nrcc_message_scroll.moveTo(matrix_width, std::chrono::steady_clock::now());
+    // The 2nd/3rd departure rolls up at a speed in pixels per second too - 0 just switches
+    enable_2nd_3rd_departure_scroll = config.getInt("third_line_scroll_speed") > 0;
+    third_row_scroll.setSpeed(config.getInt("third_line_scroll_speed"));
     
     // Store the amount of space available to display the calling points;
     // Width of 'Calling at:' never changes
     calling_at_text.setTextAndWidth("Calling at:", font_cache);
     space_for_calling_points = matrix_width - calling_at_text.width;
-    scroll_calling_points = true;
     
     // Initialise toggle states
     first_row_state = ETD;
     third_row_state = SECOND_TRAIN;
     fourth_row_state = LOCATION;
     message_scroll_complete = false;
-    data_refresh_pending = false;
-    data_refresh_completed = false;
-    
-    // Initialise display toggle states
-    refresh_first_departure = true;
-    refresh_2nd_3rd_departure = true;
-    refresh_location = true;
-    scroll_2nd_3rd_departures = false; // only scroll when the toggle between 2nd and 3rd departure happens (not in use right now)
-    refresh_first_departure_etd_coaches_first_pass_complete = false;
-    refresh_whole_display = true;
-    refresh_whole_display_first_pass_complete = false;
-    refresh_whole_display_second_pass_complete = false;
+    model_published = false;
+    
+    // Initialise display toggle states - the damage tracker starts with everything to draw
+    scroll_2nd_3rd_departures = false; // only scroll when the toggle between 2nd and 3rd departure happens
+    offset_2nd_3rd_departure_scroll = 0;
     
     // Initialize toggle timestamps
-    last_first_row_toggle = std::chrono::steady_clock::now();
-    last_third_row_toggle = std::chrono::steady_clock::now();
     last_fourth_row_toggle = std::chrono::steady_clock::now();
-    last_refresh = std::chrono::steady_clock::now();
     
-    DEBUG_PRINT("Display initialisation. font: " << config.get("fontPath") << std::endl <<
+    DEBUG_PRINT("Display initialisation. font: " << config.get("fontPath") << " (" << font.glyphs() << " glyphs" << (font.fromCache() ? ", from " + config.get("font_atlas_path") : "") << ")" << std::endl <<
                 "Selected platform (bool/platform): " << selected_platform << "/" << platform_selected << std::endl <<
                 "Showing Location: " << show_location << std::endl <<
                 "Showing messages: " << show_messages << std::endl <<
                 "Showing platforms: " << show_platforms);
     DEBUG_PRINT("Configuration: " << std::endl <<
                 "Matrix width: " << matrix_width << std::endl <<
-                "first_departure y: " << first_departure.y_position << std::endl <<
-                "calling_points_text y: " << calling_points_text.y_position << std::endl <<
-                "calling_points_text x: " << calling_points_text.x_position << std::endl <<
-                "calling_at_text y: " << calling_at_text.y_position << std::endl <<
+                "first line y: " << first_line_y << std::endl <<
+                "second line y: " << second_line_y << std::endl <<
+                "third line y: " << third_line_y << std::endl <<
+                "fourth line y: " << fourth_line_y << std::endl <<
                 "calling_at_text x: " << calling_at_text.x_position << std::endl <<
-                "second_departure y: " << second_departure.y_position << std::endl <<
-                "second_departure etd y: " << second_departure_etd.y_position << std::endl <<
-                "third_departure y: " << third_departure.y_position << std::endl <<
-                "third_departure etd y: " << third_departure_etd.y_position << std::endl <<
-                "nrcc_message_text y: " << nrcc_message_text.y_position << std::endl <<
-                "nrcc_message_text x: " << nrcc_message_text.x_position << std::endl <<
                 "ETD_coach_refresh_seconds: " << ETD_coach_refresh_seconds << std::endl <<
                 "third_line_refresh_seconds: " << third_line_refresh_seconds << std::endl <<
                 "Message_Refresh_interval: " << Message_Refresh_interval << std::endl <<
-                "refresh_interval_seconds (data): " << refresh_interval_seconds << ".");
+                "refresh_interval_seconds (data): " << config.getInt("refresh_interval_seconds") << ".");
                 
-    // Initial data load and version set
+    // Initial data load and version set - the parser already holds the first board, so lay it out here
     display_data_version = 1;
     api_data_version = 1;
-    updateDisplayContent();
+    built_model = buildDisplayModel();
+    model = built_model;
     
     // Initial clock value
     updateClockDisplay();
 }
 
-void TrainServiceDisplay::updateDisplayContent() {
+// Runs on the refresh worker (and once in the constructor) - everything here reads only the parser,
+// the font cache and settings fixed at construction, so nothing is shared with the render loop
+std::shared_ptr<const DisplayModel> TrainServiceDisplay::buildDisplayModel() {
+    std::shared_ptr<DisplayModel> built = std::make_shared<DisplayModel>();
+    DisplayModel& m = *built;
+    
+    m.first_departure.y_position = first_line_y;
+    m.first_departure_etd.y_position = first_line_y;
+    m.first_departure_coaches.y_position = first_line_y;
+    m.calling_points_text.y_position = second_line_y;
+    m.second_departure.y_position = third_line_y;
+    m.second_departure_etd.y_position = third_line_y;
+    m.third_departure.y_position = third_line_y;
+    m.third_departure_etd.y_position = third_line_y;
+    m.location_name_text.y_position = fourth_line_y;
+    m.nrcc_message_text.y_position = fourth_line_y;
 
     try {
+        m.data_version = parser.getCurrentVersion();
+        
+        // If we're showing the location then get the width and calculate the x position to centre on the display
+        if (show_location) {
+            m.location_name_text.setTextAndWidth(parser.getLocationName(), font_cache);
+            m.location_name_text.x_position = (matrix_width - m.location_name_text.width)/2;
+        }
+        
         // Get the number of services
-        num_services = parser.getNumberOfServices();
-        DEBUG_PRINT("Updating the Display Content");
-        DEBUG_PRINT("Number of services available: " << num_services);
+        m.num_services = parser.getNumberOfServices();
+        DEBUG_PRINT("Building the Display Content");
+        DEBUG_PRINT("Number of services available: " << m.num_services);
         
-        if (num_services == 0) {
-            first_departure = "No services";
-            calling_points_text = "";
-            second_departure = "";
-            third_departure = "";
-            return;
+        if (m.num_services == 0) {
+            m.first_departure = "No services";
+            return built;
         }
         
         DEBUG_PRINT("Showing platforms: " << show_platforms);
@@ -174,381 +201,627 @@ void TrainServiceDisplay::updateDisplayContent() {
         parser.findServices();
         
         // Create the Top Line - get the index of the first service to depart.
-        first_service_index = parser.getFirstDeparture();
+        size_t first_service_index = parser.getFirstDeparture();
         
         if(first_service_index == 999) {
-            first_departure= "No more services";
-            calling_points_text = "";
-            calling_at_text = "";
+            m.first_departure = "No more services";
         } else {
+            m.has_first_service = true;
+            
             // Populate the ServiceInfo struct for the first service.
-            first_service_info = parser.getService(first_service_index);
+            TrainServiceParser::TrainServiceInfo first_service_info = parser.getService(first_service_index);
             
             // Populate the first departure on the top line
-            first_departure = "";
-            first_departure << first_service_info.scheduledTime << " ";
+            m.first_departure << first_service_info.scheduledTime << " ";
             
             // Instert"'Plat." and the platform number if we're showing platforms.
             if (show_platforms && !first_service_info.platform.empty()) {
-                first_departure << "Plat." << first_service_info.platform << " ";
+                m.first_departure << "Plat." << first_service_info.platform << " ";
             }
             
-            first_departure << first_service_info.destination << " ";
+            m.first_departure << first_service_info.destination << " ";
+            m.first_departure.setWidth(font_cache);
             
             // Populate Coaches and ETD
-            first_departure_etd.setTextAndWidth(first_service_info.estimatedTime, font_cache);
+            m.first_departure_etd.setTextAndWidth(first_service_info.estimatedTime, font_cache);
             
             // If there's no coach information we'll just display the ETD.
             if (first_service_info.coaches.empty()) {
-                first_departure_coaches = first_departure_etd;
+                m.first_departure_coaches = m.first_departure_etd;
             } else {
-                first_departure_coaches.setTextAndWidth(first_service_info.coaches + " coaches", font_cache);
+                m.first_departure_coaches.setTextAndWidth(first_service_info.coaches + " coaches", font_cache);
             }
     
             // Set x_position to right-justify the ETD and Coaches text
-            first_departure_etd.x_position = matrix_width - first_departure_etd.width;
-            first_departure_coaches.x_position = matrix_width - first_departure_coaches.width;
+            m.first_departure_etd.x_position = matrix_width - m.first_departure_etd.width;
+            m.first_departure_coaches.x_position = matrix_width - m.first_departure_coaches.width;
             
             // Create calling points
-            calling_points_text = "";
             if(first_service_info.isCancelled) {
-                calling_points_text << first_service_info.cancelReason;
+                m.calling_points_text << first_service_info.cancelReason;
             } else {
                 // Because we lazy-load the calling-points, we have to use the getCallingPoints method. The calling points are stored in the parser class after this has run.
-                calling_points_text << parser.getCallingPoints(first_service_index) << " " << first_service_info.operator_name << parser.getCoaches(first_service_index, true);
+                m.calling_points_text << parser.getCallingPoints(first_service_index) << " " << first_service_info.operator_name << parser.getCoaches(first_service_index, true);
             }
             
             if(first_service_info.isDelayed){
                 if(!first_service_info.delayReason.empty()){
-                    calling_points_text << " - " << first_service_info.delayReason;
+                    m.calling_points_text << " - " << first_service_info.delayReason;
                 }
             }
             
-            calling_points_text.setWidth(font_cache);
+            m.calling_points_text.setWidth(font_cache);
             // If the width of the calling points is less than the width of the space for the calling points, then don't scroll.
-            scroll_calling_points = (calling_points_text.width < space_for_calling_points ? false : true);
+            m.scroll_calling_points = (m.calling_points_text.width < space_for_calling_points ? false : true);
             
             DEBUG_PRINT("Display Content update:" << std::endl <<
-                        "First Departure:" << first_departure.text << std::endl <<
-                        "Calling Points: " << calling_points_text.text << " (width of the scroll: " << calling_points_text.width << ")" );
+                        "First Departure:" << m.first_departure.text << std::endl <<
+                        "Calling Points: " << m.calling_points_text.text << " (width of the scroll: " << m.calling_points_text.width << ")" );
         }
 
         // Create the Second Line
-        second_service_index = parser.getSecondDeparture();
+        size_t second_service_index = parser.getSecondDeparture();
         if(second_service_index == 999) {
-            second_departure = "No more services";
-            second_departure_etd = "";
+            m.second_departure = "No more services";
         } else {
-            second_service_info = parser.getService(second_service_index);
+            TrainServiceParser::TrainServiceInfo second_service_info = parser.getService(second_service_index);
 
-            second_departure = "2nd ";
-            second_departure << second_service_info.scheduledTime + " ";
+            m.second_departure = "2nd ";
+            m.second_departure << second_service_info.scheduledTime + " ";
             if(show_platforms && !second_service_info.platform.empty()) {
-                second_departure << "Plat." << second_service_info.platform << " ";
+                m.second_departure << "Plat." << second_service_info.platform << " ";
             }
-            second_departure << second_service_info.destination << " ";
+            m.second_departure << second_service_info.destination << " ";
+            m.second_departure.setWidth(font_cache);
             
             // Populate Coaches and ETD
-            second_departure_etd.setTextAndWidth(second_service_info.estimatedTime, font_cache);
+            m.second_departure_etd.setTextAndWidth(second_service_info.estimatedTime, font_cache);
     
             // Set x_position to right-justify the text
-            second_departure_etd.x_position = matrix_width - second_departure_etd.width;
-            
-            //DEBUG_PRINT("-----------------------");
-            //if(debug_mode) parser.debugPrintServiceStruct(second_service_index);
-            DEBUG_PRINT("2nd Departure: " << second_departure.text << std::endl <<
-                        "2nd Departure ETD: " << second_departure_etd.text);
+            m.second_departure_etd.x_position = matrix_width - m.second_departure_etd.width;
             
+            DEBUG_PRINT("2nd Departure: " << m.second_departure.text << std::endl <<
+                        "2nd Departure ETD: " << m.second_departure_etd.text);
         }
 
         // Create the Third Line
-        third_service_index = parser.getThirdDeparture();
+        size_t third_service_index = parser.getThirdDeparture();
         if(third_service_index == 999) {
-            third_departure = "No more services";
-            third_departure_etd = "";
+            m.third_departure = "No more services";
         } else {
-            third_service_info = parser.getService(third_service_index);
+            TrainServiceParser::TrainServiceInfo third_service_info = parser.getService(third_service_index);
             
-            third_departure = "3rd ";
-            third_departure << third_service_info.scheduledTime << " ";
+            m.third_departure = "3rd ";
+            m.third_departure << third_service_info.scheduledTime << " ";
             
             if(show_platforms && !third_service_info.platform.empty()) {
-                third_departure << "Plat." <<  third_service_info.platform << " ";
+                m.third_departure << "Plat." <<  third_service_info.platform << " ";
             }
             
-            third_departure << third_service_info.destination << " ";
+            m.third_departure << third_service_info.destination << " ";
+            m.third_departure.setWidth(font_cache);
             
             // Populate Coaches and ETD
-            third_departure_etd.setTextAndWidth(third_service_info.estimatedTime, font_cache);
+            m.third_departure_etd.setTextAndWidth(third_service_info.estimatedTime, font_cache);
             
             // Set x_position to right-justify the text
-            third_departure_etd.x_position = matrix_width - third_departure_etd.width;
+            m.third_departure_etd.x_position = matrix_width - m.third_departure_etd.width;
             
-            //DEBUG_PRINT("-----------------------");
-            //if(debug_mode) parser.debugPrintServiceStruct(third_service_index);
-            DEBUG_PRINT("3rd Departure: " << third_departure.text<< std::endl <<
-                        "3rd Departure ETD: " << third_departure_etd.text);
+            DEBUG_PRINT("3rd Departure: " << m.third_departure.text<< std::endl <<
+                        "3rd Departure ETD: " << m.third_departure_etd.text);
         }
         
         // Get any NRCC messages
-        has_message = false;
-        nrcc_message_text = "";
-        
         if (show_messages) {
-            nrcc_message_text << parser.getNrccMessages();
-            has_message = !nrcc_message_text.empty();
-            DEBUG_PRINT("NRCC Message: " << (has_message ? nrcc_message_text.text : "None"));
-            // End New
+            m.nrcc_message_text << parser.getNrccMessages();
+            m.has_message = !m.nrcc_message_text.empty();
+            DEBUG_PRINT("NRCC Message: " << (m.has_message ? m.nrcc_message_text.text : "None"));
         }
         
         // Calculate text widths for scrolling
-        nrcc_message_text.setWidth(font_cache);
-        
-        // Set refresh flag to trigger display update
-        DEBUG_PRINT ("Setting the flag to refresh the display");
-        refresh_whole_display = true;
+        m.nrcc_message_text.setWidth(font_cache);
         
     } catch (const std::exception& e) {
         DEBUG_PRINT("Error updating display content: " << e.what());
         // Set fallback content in case of error
-        first_departure = "Error fetching data";
-        calling_points_text = e.what();
-        second_departure = "Error fetching data";
-        third_departure = "Error fetching data";
-        // End new
+        m.has_first_service = false;
+        m.first_departure = "Error fetching data";
+        m.calling_points_text = e.what();
+        m.calling_points_text.setWidth(font_cache);
+        m.scroll_calling_points = true;
+        m.second_departure = "Error fetching data";
+        m.third_departure = "Error fetching data";
     }
+    
+    // Render the scrolling text once here, so each frame only copies what's visible
+    m.calling_points_strip.render(font, m.calling_points_text);
+    m.nrcc_message_strip.render(font, m.nrcc_message_text);
+    
+    return built;
 }
 
-void TrainServiceDisplay::updateClockDisplay() {
-    // Get current time
-    auto now = std::time(nullptr);
-    auto tm = std::localtime(&now);
+// Worker side - hand the model over; it's only read from here on
+void TrainServiceDisplay::publishDisplayModel(std::shared_ptr<const DisplayModel> built) {
+    // Nothing on screen would change, so don't make the render loop redraw the whole display
+    if (built_model && built->sameContent(*built_model)) {
+        DEBUG_PRINT("Display content unchanged (data version " << built->data_version << ") - not publishing.");
+        return;
+    }
+    built_model = built;
+    {
+        std::lock_guard<std::mutex> lock(model_mutex);
+        pending_model = std::move(built);
+        model_published.store(true, std::memory_order_release);
+    }
+    model_wake.notify_one();
+}
+
+// Render side - called between frames, so a frame is always drawn from a single model
+bool TrainServiceDisplay::adoptDisplayModel() {
+    if (!model_published.load(std::memory_order_acquire)) {
+        return false;
+    }
+    std::shared_ptr<const DisplayModel> adopted;
+    {
+        std::lock_guard<std::mutex> lock(model_mutex);
+        adopted.swap(pending_model);
+        model_published.store(false, std::memory_order_relaxed);
+    }
+    if (!adopted) {
+        return false;
+    }
+    model.swap(adopted);   // The previous model is released here, after the lock
+    
+    // Redraw only the rows the new model changed
+    unsigned changed_rows = model->changedRows(*adopted);
+    damageRows(changed_rows);
+    
+    // Keep the scrolls going from where they are, unless the new text has already scrolled off
+    auto now = std::chrono::steady_clock::now();
+    if (calling_points_scroll.x() < -model->calling_points_text.width) {
+        calling_points_scroll.moveTo(matrix_width, now);
+        damage.damage(REGION_CALLING_POINTS);
+    }
+    if (nrcc_message_scroll.x() < -model->nrcc_message_text.width) {
+        nrcc_message_scroll.moveTo(matrix_width, now);
+        damage.damage(REGION_FOURTH_ROW);
+    }
     
-    // Format time as HH:MM:SS in 24-hour format
-    std::ostringstream timeStream;
-    timeStream << std::setfill('0') << std::setw(2) << tm->tm_hour << ":"
-               << std::setfill('0') << std::setw(2) << tm->tm_min << ":"
-               << std::setfill('0') << std::setw(2) << tm->tm_sec;
+    DEBUG_PRINT ("Rows changed by the new model (bit mask): " << changed_rows);
+    display_data_version.fetch_add(1, std::memory_order_release);
     
-    clock_display_text.setTextAndWidth(timeStream.str(), font_cache);
+    DEBUG_PRINT("Display model adopted. API version: " << getCurrentAPIVersion() << ". Display version: " << getCurrentDisplayVersion() << ". Model data version: " << model->data_version);
+    return true;
+}
+
+int TrainServiceDisplay::updateClockDisplay() {
+    // Nothing to do until the second rolls over
+    std::time_t now = std::time(nullptr);
+    if (now == clock_time && !clock_display_text.text.empty()) {
+        return CLOCK_CHARS;
+    }
+    clock_time = now;
+    std::tm local_tm;
+    localtime_r(&now, &local_tm);
+    
+    // Format time as HH:MM:SS in 24-hour format - straight into a fixed buffer
+    char formatted[CLOCK_CHARS + 1];
+    formatted[0] = static_cast<char>('0' + local_tm.tm_hour / 10);
+    formatted[1] = static_cast<char>('0' + local_tm.tm_hour % 10);
+    formatted[2] = ':';
+    formatted[3] = static_cast<char>('0' + local_tm.tm_min / 10);
+    formatted[4] = static_cast<char>('0' + local_tm.tm_min % 10);
+    formatted[5] = ':';
+    formatted[6] = static_cast<char>('0' + local_tm.tm_sec / 10);
+    formatted[7] = static_cast<char>('0' + local_tm.tm_sec % 10);
+    formatted[CLOCK_CHARS] = '\0';
+    
+    // Usually only the last digit changes
+    int first_changed = 0;
+    if (clock_display_text.text.size() == CLOCK_CHARS) {
+        while (first_changed < CLOCK_CHARS && clock_display_text.text[first_changed] == formatted[first_changed]) {
+            first_changed++;
+        }
+        if (first_changed == CLOCK_CHARS) {
+            return CLOCK_CHARS;
+        }
+    }
+    
+    // The string keeps its capacity and the glyph tables their size, so nothing is allocated after the first time
+    clock_display_text.text.assign(formatted, CLOCK_CHARS);
+    clock_display_text.setWidth(font_cache);
     clock_display_text.x_position = matrix_width - clock_display_text.width;
+    return first_changed;
 }
 
-void TrainServiceDisplay::clearArea(int x_origin, int y_origin, int x_size, int y_size) {
-    int x,y;
+// The band of pixels a line of text occupies
+Rect TrainServiceDisplay::regionRect(DisplayRegion region) const {
+    // The clock sits at the right of the fourth line with a small gap before it
+    int clock_left = clock_display_text.x_position - 2;
     
-    for (x = x_origin; x < x_size; x++) {
-        for ( y = y_origin; y < y_size; y++) {
-            if (y >= 0 && y < matrix_height && x >= 0 && x < matrix_width) {
-                canvas->SetPixel(x, y, black.r, black.g, black.b);
-            }
+    // A clock character's cell - the first takes in the gap, the last runs to the edge
+    if (region & REGION_CLOCK) {
+        int index = 0;
+        while (!(region & (REGION_CLOCK_FIRST_CHAR << index))) {
+            index++;
+        }
+        const std::vector<int>& offsets = clock_display_text.glyph_offsets;
+        if (offsets.size() != CLOCK_CHARS + 1) {
+            return Rect(clock_left, fourth_line_y - font_baseline, matrix_width - clock_left, font_height);
+        }
+        int left = (index == 0) ? clock_left : clock_display_text.x_position + offsets[index];
+        int right = (index == CLOCK_CHARS - 1) ? matrix_width : clock_display_text.x_position + offsets[index + 1];
+        return Rect(left, fourth_line_y - font_baseline, right - left, font_height);
+    }
+    
+    switch (region) {
+        case REGION_FIRST_ROW:
+            return Rect(0, first_line_y - font_baseline, matrix_width, font_height);
+        case REGION_FIRST_ROW_ETD: {
+            // Wide enough for either the ETD or the coaches, whichever is showing
+            int cell_left = std::min(model->first_departure_etd.x_position, model->first_departure_coaches.x_position);
+            return Rect(cell_left, first_line_y - font_baseline, matrix_width - cell_left, font_height);
         }
+        case REGION_CALLING_AT:
+            return Rect(0, second_line_y - font_baseline, calling_at_text.width, font_height);
+        case REGION_CALLING_POINTS:
+            return Rect(calling_at_text.width, second_line_y - font_baseline, matrix_width - calling_at_text.width, font_height);
+        case REGION_THIRD_ROW:
+            return Rect(0, third_line_y - font_baseline, matrix_width, font_height);
+        case REGION_FOURTH_ROW:
+            return Rect(0, fourth_line_y - font_baseline, clock_left, font_height);
+        default:
+            break;
     }
+    return Rect();
 }
 
-void TrainServiceDisplay::renderFrame() {
-    if (refresh_whole_display) {
-        if (refresh_whole_display_first_pass_complete && refresh_whole_display_second_pass_complete) {
-            //This is a new refresh
-            refresh_whole_display_first_pass_complete = false;
-            refresh_whole_display_second_pass_complete = false;
-        }        
-        // Clear the Canvas and trigger refresh of all static elements
-        canvas->Clear();
-        refresh_first_departure = true;
-        refresh_first_departure_etd_coaches = true;
-        // Disabling this for now as the vertical scroll is resource hungry
-        //if(!scroll_2nd_3rd_departures) { // Don't interrupt a scroll of the 2nd/3rd departures
-        //    refresh_2nd_3rd_departure = true;
-        //    offset_2nd_3rd_departure_scroll = font_height;
-        //}
-        // When we can put the vertical scroll back in, comment out the next line
-        refresh_2nd_3rd_departure = true;
-        refresh_location = true;
-    }
-    
-    // Draw static top line
-    if (refresh_first_departure == true) {
-        rgb_matrix::DrawText(canvas, font, 0, first_departure.y_position, white, first_departure.text.c_str());
-        refresh_first_departure = false;
-    }
-    
-    // Draw right-justified ETD or Coach configuration for the first service if the first service exists
-    if(first_service_index != 999) {
-        if (refresh_first_departure_etd_coaches) {
-            if (first_row_state == ETD) {
-                rgb_matrix::DrawText(canvas, font, first_departure_etd.x_position, first_departure_etd.y_position, white, first_departure_etd.text.c_str());
+// Draws everything that appears in a region - the target canvas clips it to the region
+void TrainServiceDisplay::drawRegion(DisplayRegion region, Canvas* target) {
+    // Text is only drawn as far as it's visible in the region
+    Rect clip = regionRect(region);
+    int clip_left = clip.x;
+    int clip_right = clip.x + clip.width;
+    
+    // The clip leaves just the one character of the clock
+    if (region & REGION_CLOCK) {
+        clock_display_text.draw(target, font, clock_display_text.x_position, clock_display_text.y_position, white, clip_left, clip_right);
+        return;
+    }
+    
+    switch (region) {
+        case REGION_FIRST_ROW:
+        case REGION_FIRST_ROW_ETD:
+            // The first departure can run under the ETD cell, so it's drawn for both
+            model->first_departure.draw(target, font, 0, model->first_departure.y_position, white, clip_left, clip_right);
+            // Right-justified ETD or Coach configuration if the first service exists
+            if (model->has_first_service) {
+                const DisplayText& etd_coaches = (first_row_state == ETD ? model->first_departure_etd : model->first_departure_coaches);
+                etd_coaches.draw(target, font, etd_coaches.x_position, etd_coaches.y_position, white, clip_left, clip_right);
+            }
+            break;
+            
+        case REGION_CALLING_AT:
+            // Only when there's a departure for it to belong to
+            if (model->has_first_service) {
+                calling_at_text.draw(target, font, 0, calling_at_text.y_position, white, clip_left, clip_right);
+            }
+            break;
+            
+        case REGION_CALLING_POINTS:
+            drawScrollingText(target, clip, model->calling_points_text, model->calling_points_strip, calling_points_scroll.x());
+            break;
+            
+        case REGION_THIRD_ROW:
+            if (third_row_state == SECOND_TRAIN) {
+                model->second_departure.draw(target, font, 0, model->second_departure.y_position, white, clip_left, clip_right);
+                model->second_departure_etd.draw(target, font, model->second_departure_etd.x_position, model->second_departure_etd.y_position, white, clip_left, clip_right);
             } else {
-                rgb_matrix::DrawText(canvas, font, first_departure_coaches.x_position, first_departure_coaches.y_position, white, first_departure_coaches.text.c_str());
+                model->third_departure.draw(target, font, 0, model->third_departure.y_position, white, clip_left, clip_right);
+                model->third_departure_etd.draw(target, font, model->third_departure_etd.x_position, model->third_departure_etd.y_position, white, clip_left, clip_right);
             }
-            if(!refresh_first_departure_etd_coaches_first_pass_complete) {
-                refresh_first_departure_etd_coaches_first_pass_complete = true;
+            break;
+            
+        case REGION_FOURTH_ROW:
+            if (fourth_row_state == LOCATION) {
+                model->location_name_text.draw(target, font, model->location_name_text.x_position, model->location_name_text.y_position, white, clip_left, clip_right);
             } else {
-                refresh_first_departure_etd_coaches = false;
+                drawScrollingText(target, clip, model->nrcc_message_text, model->nrcc_message_strip, nrcc_message_scroll.x());
             }
-        }
+            break;
+            
+        default:
+            break;
     }
+}
+
+// Map rows a new model changed onto display regions
+void TrainServiceDisplay::damageRows(unsigned rows) {
+    unsigned regions = 0;
+    if (rows & DisplayModel::FIRST_ROW) {
+        regions |= REGION_FIRST_ROW;
+    }
+    if (rows & DisplayModel::SECOND_ROW) {
+        regions |= REGION_CALLING_AT | REGION_CALLING_POINTS;
+    }
+    if (rows & DisplayModel::THIRD_ROW) {
+        regions |= REGION_THIRD_ROW;
+    }
+    if (rows & DisplayModel::FOURTH_ROW) {
+        regions |= REGION_FOURTH_ROW;
+    }
+    damage.damage(regions);
+    // New departures on the third row replace it straight away - a roll would be between old ones
+    if (regions & REGION_THIRD_ROW) {
+        stopThirdRowScroll();
+    }
+    // Layers of the old content are no use now - the ETD cell goes with the first row
+    layer_cache.invalidate((regions & REGION_FIRST_ROW) ? regions | REGION_FIRST_ROW_ETD : regions);
+}
+
+// The static regions are cached by toggle state - scrolling text and the clock change too often to be worth it
+bool TrainServiceDisplay::layerState(DisplayRegion region, int& state) const {
+    switch (region) {
+        case REGION_FIRST_ROW:
+        case REGION_FIRST_ROW_ETD:
+            state = first_row_state;
+            return true;
+        case REGION_CALLING_AT:
+            state = 0;
+            return true;
+        case REGION_THIRD_ROW:
+            state = third_row_state;
+            return true;
+        case REGION_FOURTH_ROW:
+            state = fourth_row_state;
+            return fourth_row_state == LOCATION;
+        default:
+            return false;
+    }
+}
+
+void TrainServiceDisplay::renderFrame() {
+    frame_pacer.frameStarted(std::chrono::steady_clock::now());
     
+    // Call fn for each region in a mask - the ETD cell is part of the first row, so not twice
+    auto for_each_region = [](unsigned regions, const std::function<void(DisplayRegion)>& fn) {
+        for (unsigned region = 1; region <= REGION_LAST; region <<= 1) {
+            if ((regions & region) && !(region == REGION_FIRST_ROW_ETD && (regions & REGION_FIRST_ROW))) {
+                fn(static_cast<DisplayRegion>(region));
+            }
+        }
+    };
     
-    // Draw scrolling calling points with wrap-around
-    renderScrollingCallingPoints();
-    
-    // Draw current third line content
-    
-    // This condition is modified if scrolling is enabled.  Needed to stop a refresh if a scroll is in progress
-    //if (refresh_2nd_3rd_departure && !scroll_2nd_3rd_departures) {
-    
-    if (refresh_2nd_3rd_departure) {
-        // Clear the whole area
-        clearArea(0, second_departure.y_position, matrix_width, second_departure.y_position + font_height - font_baseline);
-        
-        // Now display 2nd/3rd departure and the ETD
-        if (third_row_state == SECOND_TRAIN) {
-            rgb_matrix::DrawText(canvas, font, 0, second_departure.y_position, white, second_departure.text.c_str());
-            rgb_matrix::DrawText(canvas, font, second_departure_etd.x_position, second_departure_etd.y_position, white, second_departure_etd.text.c_str());
+    // Bring the frame buffer up to date - each change is drawn into it once, however many canvases need it
+    unsigned changed = damage.takeChanged();
+    bool redraw_all = (changed == DamageTracker::ALL);
+    if (redraw_all) {
+        frame_buffer.Clear();
+    }
+    for_each_region(changed, [&](DisplayRegion region) {
+        Rect area = regionRect(region);
+        if (region == REGION_THIRD_ROW && scroll_2nd_3rd_departures) {
+            composeThirdRowScroll(area);
         } else {
-            rgb_matrix::DrawText(canvas, font, 0, third_departure.y_position, white, third_departure.text.c_str());
-            rgb_matrix::DrawText(canvas, font, third_departure_etd.x_position, third_departure_etd.y_position, white, third_departure_etd.text.c_str());
+            composeRegion(region, area, redraw_all);
         }
-        refresh_2nd_3rd_departure = false;
-    }
-    
-    // Disabling this for the timebeing.
-    // It looks great but slows the horizontal scrolls (messages/calling-points) when it runs as it's rather resource-hungry.
-    // I sense the processing limits of the Pi4 are being reached!
-    // If a scroll has been initiated by a change from showing 2nd and 3rd departures.
-    //if (scroll_2nd_3rd_departures) {
-    //    // Clear across the display from scroll baseline to the bottom of the display
-    //    clearArea(0, baseline_2nd_3rd_departure_scroll - font_baseline, matrix_width, matrix_height);
-    //
-    //    // Display the 2nd/3rd departure text, offset by offset_2nd_3rd_departure_scroll
-    //    if (offset_2nd_3rd_departure_scroll > -1) {
-    //        if (third_row_state == SECOND_TRAIN) {
-    //            rgb_matrix::DrawText(canvas, font, 0, second_departure.y_position + offset_2nd_3rd_departure_scroll, white, second_departure.text.c_str());
-    //            rgb_matrix::DrawText(canvas, font, second_departure_etd.x_position, second_departure_etd.y_position + offset_2nd_3rd_departure_scroll, white, second_departure_etd.text.c_str());
-    //        } else {
-    //            rgb_matrix::DrawText(canvas, font, 0, third_departure.y_position + offset_2nd_3rd_departure_scroll, white, third_departure.text.c_str());
-    //            rgb_matrix::DrawText(canvas, font, third_departure_etd.x_position, third_departure_etd.y_position + offset_2nd_3rd_departure_scroll, white, third_departure_etd.text.c_str());
-    //        }
-    //    }
-    //    if (scroll_2nd_3rd_departures_first_pass){  // Ensures two passes to cater for canvas swap
-    //        scroll_2nd_3rd_departures_first_pass = false;
-    //    } else {
-    //        offset_2nd_3rd_departure_scroll --; // Once two passes have completed, decrease the scroll offset and initiate a first_pass
-    //       scroll_2nd_3rd_departures_first_pass = true;
-    //    }
-    //
-    //    if (scroll_2nd_3rd_departures_first_pass && offset_2nd_3rd_departure_scroll < 0) { // Scroll complete as scroll offset is < 0 (happens after 2nd pass at offset=0
-    //        scroll_2nd_3rd_departures = false;
-    //        refresh_2nd_3rd_departure = false;
-    //    }
-    //
-    //    if (fourth_row_state == LOCATION) refresh_location = true; // the vertical scroll method over-writes the 4th line. OK for scrolling but not when showing the static location, so need to trigger a redraw.
-    //}
-     
-    // Draw fourth line
-    
-    if (fourth_row_state == LOCATION) { // Show the location
-        if (refresh_location) {
-            // Clear the whole line
-            clearArea(0, location_name_text.y_position - font_baseline, matrix_width, location_name_text.y_position + font_height - font_baseline);
-            // Display the location
-            rgb_matrix::DrawText(canvas, font, location_name_text.x_position, location_name_text.y_position, white, location_name_text.text.c_str());
-            // Prevent the location being displayed again
-            refresh_location = false;
+    });
+    
+    // Pipelined, the presenter copies the frame across and swaps while the next one is drawn
+    if (presenter) {
+        changed_rects.clear();
+        if (redraw_all) {
+            changed_rects.push_back(Rect(0, 0, matrix_width, matrix_height));
+        } else {
+            for_each_region(changed, [&](DisplayRegion region) { changed_rects.push_back(regionRect(region)); });
         }
-    } else { // Scroll the message
-        renderScrollingMessage();
-        // The flag to refresh the location text is set in the transitionFourthRowState method
+        presenter->submit(frame_buffer, changed_rects, frame_pacer.frameComposed(std::chrono::steady_clock::now()));
+        return;
     }
     
-    // Update and draw the clock
-    updateClockDisplay();
-    
-    // Clear the area where the clock will be displayed.  Note the '-2' is applied to the x position to give a small gap between the clock and the scrolling message
-    clearArea(clock_display_text.x_position - 2, clock_display_text.y_position - font_baseline, matrix_width, clock_display_text.y_position + font_height - font_baseline);
-    
-    // Draw the clock
-    rgb_matrix::DrawText(canvas, font, clock_display_text.x_position, clock_display_text.y_position, white, clock_display_text.text.c_str());
+    // Then copy across what's out of date in this canvas - the other one catches up the next time it's drawn
+    unsigned stale = damage.stale();
+    Canvas* canvas = backend.canvas();
+    uint64_t pixels = 0;
+    if (stale == DamageTracker::ALL) {
+        pixels = frame_buffer.copyTo(canvas, Rect(0, 0, matrix_width, matrix_height));
+    } else {
+        for_each_region(stale, [&](DisplayRegion region) {
+            pixels += frame_buffer.copyTo(canvas, regionRect(region));
+        });
+    }
+    damage.repaired(pixels);
 
     // Update display
-    canvas = matrix->SwapOnVSync(canvas);
-    
-    // Stop the whole display being cleared (by setting refresh_whole_display to false) until the next data refresh is triggered in the updateDisplayContent method.
-    // NOTE the refresh has to happen twice as the update works using SwapOnVSync
-    if (refresh_whole_display) {
-        if (refresh_whole_display_first_pass_complete) {
-            // we're on the second pass so mark that as complete and prevent further refreshes
-            refresh_whole_display_second_pass_complete = true;
-            refresh_whole_display = false;
-        } else {
-            // we're on the first pass so mark that as complete
-            refresh_whole_display_first_pass_complete = true;
-        }
-    }
+    FramePacer::FrameTicket ticket = frame_pacer.frameComposed(std::chrono::steady_clock::now());
+    frame_pacer.swapStarted(std::chrono::steady_clock::now());
+    backend.swap();
+    frame_pacer.swapCompleted(std::chrono::steady_clock::now(), ticket);
+    damage.swapped();
 }
 
-void TrainServiceDisplay::renderScrollingCallingPoints() {
-    // Clear the scrolling text area
-    clearArea(calling_at_text.width, calling_points_text.y_position - font_baseline, matrix_width, calling_points_text.y_position + font_height - font_baseline);
-    
-    rgb_matrix::DrawText(canvas, font, calling_points_text.x_position, calling_points_text.y_position, white, calling_points_text.text.c_str());
-    if (calling_points_text.x_position < 0) {
-        rgb_matrix::DrawText(canvas, font, calling_points_text.x_position + matrix_width + calling_points_text.width, calling_points_text.y_position, white, calling_points_text.text.c_str());
+void TrainServiceDisplay::composeRegion(DisplayRegion region, const Rect& area, bool cleared) {
+    // A static region showing something it's shown before is copied back rather than drawn
+    int state = 0;
+    bool cacheable = layerState(region, state);
+    if (cacheable && layer_cache.restore(region, state, area, frame_buffer)) {
+        return;
+    }
+    if (!cleared) {
+        frame_buffer.fillRect(area, black);
+    }
+    ClippedCanvas target(&frame_buffer, area);
+    drawRegion(region, &target);
+    if (cacheable) {
+        layer_cache.store(region, state, area, frame_buffer);
     }
-    
-    // Clear the area where "Calling at:" will be displayed by drawing a black rectangle
-    clearArea(0, calling_at_text.y_position - font_baseline, calling_at_text.width, calling_at_text.y_position + font_height - font_baseline);
-    // Draw "Calling at:" text
-    rgb_matrix::DrawText(canvas, font, 0, calling_at_text.y_position, white, calling_at_text.text.c_str());
 }
 
-void TrainServiceDisplay::renderScrollingMessage() {
-    clearArea(0, nrcc_message_text.y_position - font_baseline, matrix_width, nrcc_message_text.y_position + font_height - font_baseline);
-    rgb_matrix::DrawText(canvas, font, nrcc_message_text.x_position, nrcc_message_text.y_position, white, nrcc_message_text.text.c_str());
-    if (nrcc_message_text.x_position < 0) {
-        rgb_matrix::DrawText(canvas, font, nrcc_message_text.x_position + matrix_width + nrcc_message_text.width, nrcc_message_text.y_position, white, nrcc_message_text.text.c_str());
+// The row rolling out and the row rolling in are each drawn once; every frame of the roll is a window onto
+// the two, one above the other - a memcpy per row
+void TrainServiceDisplay::composeThirdRowScroll(const Rect& area) {
+    if (third_row_scroll_to.empty()) {
+        composeRegion(REGION_THIRD_ROW, area, false);
+        frame_buffer.serialize(area, third_row_scroll_to);
+    }
+    if (!frame_buffer.deserializeRolled(area, third_row_scroll_from, third_row_scroll_to, font_height - offset_2nd_3rd_departure_scroll)) {
+        // Nothing to roll from (the row was off the display) - just show the new row
+        frame_buffer.deserialize(area, third_row_scroll_to);
     }
 }
 
+void TrainServiceDisplay::stopThirdRowScroll() {
+    scroll_2nd_3rd_departures = false;
+    offset_2nd_3rd_departure_scroll = 0;
+    third_row_scroll_from.clear();
+    third_row_scroll_to.clear();
+}
+
+// Draw text at a scroll position, with the start of the text following on once its end has passed the left edge
+// Only the columns inside the region are copied from the pre-rendered strip, however long the text is
+void TrainServiceDisplay::drawScrollingText(Canvas* target, const Rect& region, const DisplayText& text, const TextStrip& strip, int x) {
+    strip.draw(target, x, text.y_position, region, white);
+    if (x < 0) {
+        strip.draw(target, x + matrix_width + text.width, text.y_position, region, white);
+    }
+}
 
-void TrainServiceDisplay::updateScrollPositions() {
+void TrainServiceDisplay::updateScrollPositions(std::chrono::steady_clock::time_point now) {
     // Update calling points scroll position with wrap-around if the width of the calling points exceed available space.
-    // scroll_calling_points is set in the updateDisplayContent method
-    if (scroll_calling_points) {
-        calling_points_text-- ;
-        if (calling_points_text.x_position < -calling_points_text.width) {
-            calling_points_text.x_position = matrix_width;
+    // scroll_calling_points is set when the display model is built
+    // A region only needs redrawing if the text has moved a whole pixel
+    if (model->scroll_calling_points) {
+        int previous_x = calling_points_scroll.x();
+        calling_points_scroll.advance(now, model->calling_points_text.width, matrix_width);
+        if (calling_points_scroll.x() != previous_x) {
+            damage.damage(REGION_CALLING_POINTS);
         }
-    } else {calling_points_text.x_position = calling_at_text.width + 2;
-        
     }
     //Update the message scroll position and set the complete flag once that's done.
-    nrcc_message_text-- ;
-    if (nrcc_message_text.x_position < -nrcc_message_text.width) {
-        nrcc_message_text.x_position = matrix_width;
-        message_scroll_complete = true; // Required to enable the toggle to Location (if set)
+    if (fourth_row_state == MESSAGE) {
+        int previous_x = nrcc_message_scroll.x();
+        if (nrcc_message_scroll.advance(now, model->nrcc_message_text.width, matrix_width)) {
+            message_scroll_complete = true; // Required to enable the toggle to Location (if set)
+        }
+        if (nrcc_message_scroll.x() != previous_x) {
+            damage.damage(REGION_FOURTH_ROW);
+        }
+    }
+    // The 2nd/3rd departure roll - its 'x' counts down the rows left to roll, and it stops at 0
+    if (scroll_2nd_3rd_departures) {
+        third_row_scroll.advance(now, font_height, 0);
+        int offset = std::max(0, third_row_scroll.x());
+        if (offset != offset_2nd_3rd_departure_scroll) {
+            offset_2nd_3rd_departure_scroll = offset;
+            damage.damage(REGION_THIRD_ROW);
+        }
+        if (offset == 0) {
+            stopThirdRowScroll();   // The last frame of the roll is the new row as it stays
+        }
     }
 }
 
-void TrainServiceDisplay::checkFirstRowStateTransition(){
-    auto now = std::chrono::steady_clock::now();
-    
-    // For ETD/Coach, toggle based on timer
-    if (now - last_first_row_toggle >= std::chrono::seconds(ETD_coach_refresh_seconds)) {
-        transitionFirstRowState();
-        last_first_row_toggle = now;
+bool TrainServiceDisplay::isScrolling() const {
+    return model->scroll_calling_points || fourth_row_state == MESSAGE || scroll_2nd_3rd_departures;
+}
+
+// Called after anything that could start or stop a scroll (a new model, a fourth row toggle)
+void TrainServiceDisplay::updateScrollState(std::chrono::steady_clock::time_point now) {
+    // Calling points that fit sit just after 'Calling at:'
+    if (!model->scroll_calling_points && calling_points_scroll.x() != calling_at_text.width + 2) {
+        calling_points_scroll.moveTo(calling_at_text.width + 2, now);
+        damage.damage(REGION_CALLING_POINTS);
+    }
+    // Scroll ticks stop when nothing scrolls, so start them again when something does - from where the text is
+    if (isScrolling() && !scroll_tick_scheduled) {
+        calling_points_scroll.hold(now);
+        nrcc_message_scroll.hold(now);
+        third_row_scroll.hold(now);
+        scheduleEvent(SCROLL_TICK, now);
+        scroll_tick_scheduled = true;
     }
 }
 
+void TrainServiceDisplay::scheduleEvent(DisplayEvent event, std::chrono::steady_clock::time_point due) {
+    schedule.push(ScheduledEvent{due, event});
+}
 
-void TrainServiceDisplay::checkThirdRowStateTransition() {
-    auto now = std::chrono::steady_clock::now();
+// The next time the clock's seconds change (just after, so the new second is what gets drawn)
+std::chrono::steady_clock::time_point TrainServiceDisplay::nextClockTick(std::chrono::steady_clock::time_point now) const {
+    auto into_second = std::chrono::system_clock::now().time_since_epoch() % std::chrono::seconds(1);
+    return now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::seconds(1) - into_second)
+               + std::chrono::milliseconds(1);
+}
+
+void TrainServiceDisplay::handleEvent(const ScheduledEvent& scheduled, std::chrono::steady_clock::time_point now) {
+    // Periodic events keep to their own cadence, unless we've fallen more than a period behind
+    auto next = [now](std::chrono::steady_clock::time_point due, std::chrono::steady_clock::duration period) {
+        return (due + period > now) ? due + period : now + period;
+    };
     
-    // For train information, toggle based on timer
-    if (now - last_third_row_toggle >= std::chrono::seconds(third_line_refresh_seconds)) {
-        transitionThirdRowState();
-        last_third_row_toggle = now;
+    switch (scheduled.event) {
+        case SCROLL_TICK:
+            scroll_tick_scheduled = false;
+            if (isScrolling()) {
+                updateScrollPositions(now);
+                // A message can only give way to the location once it has scrolled through
+                if (fourth_row_state == MESSAGE && message_scroll_complete) {
+                    checkFourthRowStateTransition();
+                }
+                if (isScrolling()) {
+                    // Next frame when a scroll next moves a whole pixel - on the frame pacer's grid
+                    auto until_pixel = std::chrono::steady_clock::duration::max();
+                    if (model->scroll_calling_points) {
+                        until_pixel = std::min(until_pixel, calling_points_scroll.untilNextPixel());
+                    }
+                    if (fourth_row_state == MESSAGE) {
+                        until_pixel = std::min(until_pixel, nrcc_message_scroll.untilNextPixel());
+                    }
+                    if (scroll_2nd_3rd_departures) {
+                        until_pixel = std::min(until_pixel, third_row_scroll.untilNextPixel());
+                    }
+                    scheduleEvent(SCROLL_TICK, frame_pacer.scheduleFrame(now + until_pixel));
+                    scroll_tick_scheduled = true;
+                }
+            }
+            break;
+            
+        case CLOCK_TICK: {
+            int previous_x = clock_display_text.x_position;
+            int first_changed = updateClockDisplay();
+            if (clock_display_text.x_position != previous_x) {
+                // The clock has changed width - the fourth row has to give way to it (or take up the space)
+                damage.damage(REGION_CLOCK | REGION_FOURTH_ROW);
+            } else {
+                // Just the characters from the first that changed (later ones move if the digits' widths differ)
+                unsigned cells = 0;
+                for (int i = first_changed; i < CLOCK_CHARS; i++) {
+                    cells |= REGION_CLOCK_FIRST_CHAR << i;
+                }
+                damage.damage(cells);
+            }
+            scheduleEvent(CLOCK_TICK, nextClockTick(now));
+            break;
+        }
+            
+        case FIRST_ROW_TOGGLE:
+            transitionFirstRowState();
+            scheduleEvent(FIRST_ROW_TOGGLE, next(scheduled.due, std::chrono::seconds(ETD_coach_refresh_seconds)));
+            break;
+            
+        case THIRD_ROW_TOGGLE:
+            transitionThirdRowState();
+            scheduleEvent(THIRD_ROW_TOGGLE, next(scheduled.due, std::chrono::seconds(third_line_refresh_seconds)));
+            break;
+            
+        case FOURTH_ROW_CHECK: {
+            checkFourthRowStateTransition();
+            // Next check an interval after the last toggle - if that's passed we're waiting for a message
+            // to finish scrolling, which the scroll ticks look after
+            auto due = last_fourth_row_toggle + std::chrono::seconds(Message_Refresh_interval);
+            scheduleEvent(FOURTH_ROW_CHECK, due > now ? due : now + std::chrono::seconds(Message_Refresh_interval));
+            break;
+        }
     }
 }
 
@@ -556,9 +829,12 @@ void TrainServiceDisplay::checkFourthRowStateTransition() {
     auto now = std::chrono::steady_clock::now();
     bool should_toggle = false;
     
-    if (!show_messages || !has_message) {
+    if (!show_messages || !model->has_message) {
         // If messages are disabled or there aren't any, always show the location
-        fourth_row_state = LOCATION;
+        if (fourth_row_state != LOCATION) {
+            fourth_row_state = LOCATION;
+            damage.damage(REGION_FOURTH_ROW);
+        }
         return;
     }
     
@@ -583,130 +859,121 @@ void TrainServiceDisplay::checkFourthRowStateTransition() {
 void TrainServiceDisplay::transitionFirstRowState() {
     // Simply toggle between ETD and Number of Coaches
     first_row_state = (first_row_state == COACHES ? ETD : COACHES);
-    refresh_whole_display = true;
-    refresh_first_departure_etd_coaches_first_pass_complete = false;
+    damage.damage(REGION_FIRST_ROW_ETD);
 }
 
 void TrainServiceDisplay::transitionThirdRowState() {
     // Simply toggle between 2nd and 3rd train only
     third_row_state = (third_row_state == SECOND_TRAIN) ? THIRD_TRAIN : SECOND_TRAIN;
-    refresh_whole_display = true;                    // Trigger a display refresh
+    damage.damage(REGION_THIRD_ROW);                 // Redraw the row
+    if (!enable_2nd_3rd_departure_scroll) {
+        return;
+    }
+    // Roll the other train up from below - what's in the frame buffer now (on screen, or part way
+    // through a roll) rolls out of the top
+    frame_buffer.serialize(regionRect(REGION_THIRD_ROW), third_row_scroll_from);
+    third_row_scroll_to.clear();
     scroll_2nd_3rd_departures = true;                // Trigger a scroll-up of the 2nd/3rd departure row
-    scroll_2nd_3rd_departures_first_pass = true;     // Reset to first-pass of the vertical scroll
     offset_2nd_3rd_departure_scroll = font_height;   // Reset the scroll offset
+    third_row_scroll.moveTo(font_height, std::chrono::steady_clock::now());
 }
 
 void TrainServiceDisplay::transitionFourthRowState() {
-    if (has_message) {
+    if (model->has_message) {
         // Toggle between location and message
         if (fourth_row_state == LOCATION) {
             fourth_row_state = MESSAGE;
             // Reset message scroll position and completion flag
-            nrcc_message_text.x_position = matrix_width;
+            nrcc_message_scroll.moveTo(matrix_width, std::chrono::steady_clock::now());
             message_scroll_complete = false;
         } else { // MESSAGE
             fourth_row_state = LOCATION;
-            refresh_whole_display = true;
         }
+        damage.damage(REGION_FOURTH_ROW);
     } else {
         // If no message, always show clock
         fourth_row_state = LOCATION;
     }
 }
 
-void TrainServiceDisplay::refreshData() {
-    // If a refresh is already pending, don't start another one
+// Runs on the refresh worker with each payload it fetches
+void TrainServiceDisplay::refreshData(const std::string& payload) {
+    api_data_version.fetch_add(1, std::memory_order_release);
     DEBUG_PRINT("-----------------------");
-    DEBUG_PRINT("Attempting to start background API refresh.");
-    DEBUG_PRINT("Current API version: " << getCurrentAPIVersion() << ". Display version: " << getCurrentDisplayVersion() << ". Cache version: " << parser.getCurrentVersion());
-    if (data_refresh_pending.load()) {
-        return;
-    }
-    
-    // Set flag to indicate a refresh is pending
-    data_refresh_pending.store(true);
+    DEBUG_PRINT("Background API refresh. API version: " << getCurrentAPIVersion() << ". Display version: " << getCurrentDisplayVersion() << ". Cache version: " << parser.getCurrentVersion());
     
-    // Start a new thread for the API call
-    if (api_thread.joinable()) {
-        api_thread.join(); // Clean up previous thread if any
-    }
-    
-    api_thread = std::thread([this]() {
-        try {
-            // Fetch data from API
-            std::string api_data = apiClient.fetchDepartures(
-                config.get("from"), config.get("to"));
-            
-            // Store the data safely
-            {
-                std::lock_guard<std::mutex> lock(api_data_mutex);
-                new_api_data = api_data;
-            }
-            
-            // Set flags to indicate completion
-            data_refresh_completed.store(true);
-            data_refresh_pending.store(false);
-            api_data_version.fetch_add(1, std::memory_order_release);
-            
-            DEBUG_PRINT("Background API refresh completed. API version: " << getCurrentAPIVersion() << ". Display version: " << getCurrentDisplayVersion() << ". Cache version: " << parser.getCurrentVersion());
-        } catch (const std::exception& e) {
-            std::cerr << "Error refreshing data in background thread: " << e.what() << std::endl;
-            data_refresh_pending.store(false);
-        }
-    });
+    // Parse and lay out the new data here, so the render loop only ever swaps in a finished model
+    parser.updateData(payload);
+    publishDisplayModel(buildDisplayModel());
     
-    // Detach the thread so it runs independently
-    api_thread.detach();
+    DEBUG_PRINT("Background API refresh completed. API version: " << getCurrentAPIVersion() << ". Display version: " << getCurrentDisplayVersion() << ". Cache version: " << parser.getCurrentVersion());
 }
 
 void TrainServiceDisplay::run() {
+    // Start polling the API - the first board was loaded before the display was created. The threads are
+    // started before the render loop's own scheduling is applied, so they don't inherit it
+    refresh_worker.start(&refresh_thread);
+    if (presenter) {
+        presenter->start(&presenter_thread);
+    }
+    render_thread.apply();
+    
+    // Nothing runs on a fixed beat - each element schedules its next change
+    auto now = std::chrono::steady_clock::now();
+    scheduleEvent(CLOCK_TICK, nextClockTick(now));
+    scheduleEvent(FIRST_ROW_TOGGLE, now + std::chrono::seconds(ETD_coach_refresh_seconds));
+    scheduleEvent(THIRD_ROW_TOGGLE, now + std::chrono::seconds(third_line_refresh_seconds));
+    scheduleEvent(FOURTH_ROW_CHECK, now + std::chrono::seconds(Message_Refresh_interval));
+    bool frame_due = true;      // Draw the first board straight away
+    std::vector<ScheduledEvent> due_events;
+    
     while (running) {
         try {
-            // Check if it's time to start a new data refresh
-            auto now = std::chrono::steady_clock::now();
-            if (!data_refresh_pending.load() && 
-                now - last_refresh >= std::chrono::seconds(
-                refresh_interval_seconds)) {
-                refreshData();
-                last_refresh = std::chrono::steady_clock::now();
+            // Handle everything that's due - taken off the schedule first, so an event that reschedules itself
+            // for now or earlier (a frame that should already be drawing) waits for the next pass rather than
+            // running again without the time moving on
+            now = std::chrono::steady_clock::now();
+            due_events.clear();
+            while (!schedule.empty() && schedule.top().due <= now) {
+                due_events.push_back(schedule.top());
+                schedule.pop();
             }
-            
-            // Check if a data refresh has completed
-            if (data_refresh_completed.load()) {
-                // Apply the new data to the parser and update display
-                DEBUG_PRINT("API refresh complete - updating cached data.");
-                std::string api_data;
-                {
-                    std::lock_guard<std::mutex> lock(api_data_mutex);
-                    api_data = new_api_data;
-                }
-                
-                // Update the parser with new data
-                parser.updateData(api_data);
-                updateDisplayContent();
-                
-                // Reset the completion flag
-                data_refresh_completed.store(false);
-                display_data_version.fetch_add(1, std::memory_order_release);
-                
-                DEBUG_PRINT("Cache refreshed and display updated. API version: " << getCurrentAPIVersion() << ". Display version: " << getCurrentDisplayVersion() << ". Cache version: " << parser.getCurrentVersion());
+            for (const ScheduledEvent& due : due_events) {
+                handleEvent(due, now);
+                frame_due = true;
             }
             
-            // Remainder of the run method
-            // Check for state transitions
-            checkFirstRowStateTransition();
-            checkThirdRowStateTransition();
-            checkFourthRowStateTransition();
+            // Pick up a new display model if the worker has published one - between frames, never during one
+            if (adoptDisplayModel()) {
+                frame_due = true;
+            }
+            updateScrollState(now);
             
-            // Render the current frame
-            renderFrame();
+            if (frame_stats_requested.exchange(false)) {
+                writeFrameStats();
+            }
+            if (refresh_requested.exchange(false)) {
+                refresh_worker.requestRefresh();
+            }
             
-            // Update scroll positions
-            updateScrollPositions();
+            // Render the current frame - only when something on it has changed. If nothing has, the frame
+            // on screen is already right, so there's nothing to draw and no need to swap
+            if (frame_due) {
+                if (damage.hasChanges()) {
+                    renderFrame();
+                } else {
+                    frame_pacer.frameSkipped(now);
+                }
+                frame_due = false;
+            }
             
-            // Sleep for the configured time
-            std::this_thread::sleep_for(std::chrono::milliseconds(
-                config.getInt("scroll_slowdown_sleep_ms")));
+            // Sleep until the next event is due or a new model is published
+            // (a stop() from a signal handler is seen at the next event - the clock ticks every second)
+            auto wake_at = schedule.top().due;
+            std::unique_lock<std::mutex> lock(model_mutex);
+            if (!model_wake.wait_until(lock, wake_at, [this] { return model_published.load() || !running; })) {
+                render_thread.recordWake(std::chrono::steady_clock::now() - wake_at);
+            }
             
         } catch (const std::exception& e) {
             std::cerr << "Display error: " << e.what() << std::endl;
@@ -715,32 +982,71 @@ void TrainServiceDisplay::run() {
         }
     }
     
-    // Clean up the API thread if we're shutting down
-    if (api_thread.joinable()) {
-        api_thread.join();
+    // Stop the refresh worker before we return - an API call in flight is aborted
+    refresh_worker.stop();
+    if (presenter) {
+        presenter->stop();
+    }
+    
+    if (debug_mode) {
+        std::cerr << "Frame statistics:" << std::endl;
+        writeFrameReport(std::cerr);
     }
 }
 
-void TrainServiceDisplay::stop() {
-    running = false;
+// Only sets a flag, so it's safe to call from a signal handler - the stats are written at the next wake-up (within a second)
+void TrainServiceDisplay::requestFrameStats() {
+    frame_stats_requested.store(true);
+}
+
+// Only sets a flag, so it's safe to call from a signal handler - the worker is asked at the next wake-up (within a second)
+void TrainServiceDisplay::requestRefresh() {
+    refresh_requested.store(true);
+}
 
-    // Clean up the API thread if it's still running
-    if (api_thread.joinable()) {
-        api_thread.join();
+void TrainServiceDisplay::writeFrameStats() {
+    const std::string path = config.get("frame_stats_path");
+    std::ofstream stats(path);
+    if (!stats) {
+        std::cerr << "Failed to write frame statistics to " << path << std::endl;
+        return;
     }
+    writeFrameReport(stats);
+    DEBUG_PRINT("Frame statistics written to " << path);
+}
+
+// The presenter owns the backend while it's running, so the backend's report goes through it
+void TrainServiceDisplay::writeFrameReport(std::ostream& out) {
+    frame_pacer.writeReport(out);
+    if (!presenter) {
+        damage.writeReport(out);
+    }
+    layer_cache.writeReport(out);
+    if (presenter) {
+        presenter->writeReport(out);
+    } else {
+        backend.writeReport(out);
+    }
+    render_thread.writeReport(out);
+    refresh_thread.writeReport(out);
+    if (presenter) {
+        presenter_thread.writeReport(out);
+    }
+}
+
+// Only sets a flag, so it's safe to call from a signal handler - run() stops the refresh worker on its way out
+void TrainServiceDisplay::stop() {
+    running = false;
 }
 
 TrainServiceDisplay::~TrainServiceDisplay() {
     // First, signal that we're shutting down
     running = false;
     
-    // Clean up the API thread if it's still running
-    if (api_thread.joinable()) {
-        try {
-            api_thread.join();
-        } catch (const std::exception& e) {
-            std::cerr << "Error joining API thread in destructor: " << e.what() << std::endl;
-        }
+    // Stop the refresh worker and presenter if run() didn't - they mustn't outlive the display
+    refresh_worker.stop();
+    if (presenter) {
+        presenter->stop();
     }
     
     // We don't need to delete the matrix pointer here as it's passed
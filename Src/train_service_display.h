@@ -22,10 +22,27 @@
 #include <ctime>
 #include <iomanip>
 #include <tuple>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <vector>
+#include <functional>
+#include <algorithm>
 #include "config.h"
 #include "api_client.h"
 #include "train_service_parser.h"
 #include "display_text.h"
+#include "display_model.h"
+#include "refresh_worker.h"
+#include "text_scroller.h"
+#include "frame_pacer.h"
+#include "damage_tracker.h"
+#include "frame_buffer.h"
+#include "layer_cache.h"
+#include "display_backend.h"
+#include "frame_presenter.h"
+#include "thread_schedule.h"
 
 using namespace rgb_matrix;
 
@@ -36,9 +53,8 @@ extern bool debug_mode;
 class TrainServiceDisplay {
 private:
     // Hardware components
-    RGBMatrix* matrix;     // The RGB matrix object
-    FrameCanvas* canvas;   // Matrix canvas for creating content to display
-    Font font;             // Font
+    DisplayBackend& backend;   // The RGB matrix (or an in-memory display when headless)
+    GlyphAtlas font;       // Font
     FontCache font_cache;  // Cache of font sizes
     int font_baseline;     // Baseline size of the font
     int font_height;       // Height of the font
@@ -51,7 +67,6 @@ private:
     
     // Data handlers
     TrainServiceParser& parser;                   // JSON for C++ parser
-    TrainAPIClient& apiClient;                    // API client for data refresh
     std::atomic<bool> running;                    // Flag to indicate whether the display is running
     const Config& config;                         // Traindisplay configuration object
     
@@ -60,97 +75,136 @@ private:
     enum ThirdRowState { SECOND_TRAIN, THIRD_TRAIN };  // Toggle to show 2nd or 3rd train on the 3rd line
     enum FourthRowState { LOCATION, MESSAGE };         // Toggle to show the Clock alone or the Clock and message on the 4th line
     
-    // Text to be displayed - using the DisplayText class as this holds text, x/y position, width and data version
-    DisplayText first_departure;
-    DisplayText first_departure_coaches;
-    DisplayText first_departure_etd;
-    DisplayText calling_points_text;
+    // The board being displayed - built by the refresh worker and only replaced between frames
+    std::shared_ptr<const DisplayModel> model;
+    
+    // Text owned by the render loop - using the DisplayText class as this holds text, x/y position, width and data version
     DisplayText calling_at_text;
-    DisplayText second_departure;
-    DisplayText second_departure_etd;
-    DisplayText third_departure;
-    DisplayText third_departure_etd;
     DisplayText clock_display_text;
-    DisplayText nrcc_message_text;
-    DisplayText location_name_text;
     
-    // flags for refreshing display element
-    bool refresh_whole_display;                                     // Yes/No - do we need to refresh the whole display
-    bool refresh_whole_display_first_pass_complete;                 // Has the first whole-display refresh completed
-    bool refresh_whole_display_second_pass_complete;                // Has the second whole-display refresh completed
-    bool refresh_first_departure;                                   // Has the first departure refreshed
-    bool refresh_first_departure_etd_coaches;                       // Has the first departure ETD/Coach data refreshed
-    bool refresh_first_departure_etd_coaches_first_pass_complete;   // Has first departure ETD/Coach data 1st refresh completed
-    bool refresh_2nd_3rd_departure;                                 // Has the 2nd/3rd departure refreshed
-    bool refresh_location;                                          // Has the Location refreshed
+    // Baselines of the four lines of the display
+    int first_line_y;
+    int second_line_y;
+    int third_line_y;
+    int fourth_line_y;
+    
+    static const int CLOCK_CHARS = 8;                  // HH:MM:SS
+    
+    // Regions of the display that are redrawn separately - bits for the damage tracker
+    enum DisplayRegion {
+        REGION_FIRST_ROW = 1 << 0,          // First departure, ETD and coaches
+        REGION_FIRST_ROW_ETD = 1 << 1,      // Just the right-justified ETD/coaches cell
+        REGION_CALLING_AT = 1 << 2,         // 'Calling at:'
+        REGION_CALLING_POINTS = 1 << 3,     // The calling points (scrolling)
+        REGION_THIRD_ROW = 1 << 4,          // 2nd/3rd departure
+        REGION_FOURTH_ROW = 1 << 5,         // Location or message (scrolling) - up to the clock
+        REGION_CLOCK_FIRST_CHAR = 1 << 6,   // The clock - a region for each character, so a tick only redraws
+        REGION_CLOCK = ((1 << CLOCK_CHARS) - 1) * REGION_CLOCK_FIRST_CHAR,  //   the digits that changed (all of them here)
+        REGION_LAST = REGION_CLOCK_FIRST_CHAR << (CLOCK_CHARS - 1)        // The last clock character - the highest region
+    };
+    std::time_t clock_time;                            // The second the clock is showing
+    DamageTracker damage;                              // Which regions are out of date in each canvas
+    FrameBuffer frame_buffer;                          // The board as it should look - regions are drawn here and copied to the canvas
+    LayerCache layer_cache;                            // Static regions as drawn, for each toggle state
     
     // Scrolling flags and variables
     bool message_scroll_complete;                     // Yes/No - has the message been shown
     int space_for_calling_points;                     // How much space there is to display the calling points
-    bool scroll_calling_points;                       // Yes/No - this is 'true' if the calling points exceed the width of the screen
-    int baseline_2nd_3rd_departure_scroll;            // The baseline for the 2nd/3rd departure scroll
-    int offset_2nd_3rd_departure_scroll;              // Offset for vertical-scroll of the 2nd/3rd departure
-    bool scroll_2nd_3rd_departures;                   // Trigger a vertical-scroll when the 2nd changes to the 3rd departure
-    bool scroll_2nd_3rd_departures_first_pass;        // Vertical-scroll needs to be rendered twice to accommodate canvas-swap
+    TextScroller calling_points_scroll;               // Scroll position of the calling points (time-based)
+    TextScroller nrcc_message_scroll;                 // Scroll position of the NRCC message (time-based)
+    int offset_2nd_3rd_departure_scroll;              // Rows the 2nd/3rd departure still has to roll up (font height to 0)
+    bool scroll_2nd_3rd_departures;                   // Is the 2nd/3rd departure rolling up to the other train
+    bool enable_2nd_3rd_departure_scroll;             // Roll the 2nd/3rd departure up (third_line_scroll_speed > 0) - or just switch
+    TextScroller third_row_scroll;                    // Position of the roll (time-based - the 'x' is the offset)
+    std::vector<uint8_t> third_row_scroll_from;       // The row rolling out, as it was on screen
+    std::vector<uint8_t> third_row_scroll_to;         // The row rolling in - drawn with the first frame of the roll
     
     // Display options
     bool show_platforms;               // Yes/No - show platforms
     bool show_location;                // Yes/No - show location
     bool platform_selected;            // Yes/No - has a specific platform been selected
     std::string selected_platform;     // The selected platform
-    bool has_message;                  // Yes/No - are there messages
     bool show_messages;                // Yes/No - are messages being shown
-    
-    // Service Data
-    size_t num_services;                                             // The number of services available
-    TrainServiceParser::TrainServiceInfo first_service_info;         // Full Service data for the first departure
-    TrainServiceParser::TrainServiceInfo second_service_info;        // Full Service data for the second departure
-    TrainServiceParser::TrainServiceInfo third_service_info;         // Full Service data for the third departure
+    bool local_destination_filter;     // Yes/No - filter the destination locally rather than in the API call
     
     // State - for toggle on the 1st, 3rd and 4th row and API refresh interval
-    size_t first_service_index;                                      // First departure - Index of the departure
-    size_t second_service_index;                                     // Second departure - Index of the departure
-    size_t third_service_index;                                      // Third departure - Index of the departure
     FirstRowState first_row_state;                                   // First row - ETD-Coaches
     ThirdRowState third_row_state;                                   // Third row - 2nd-3rd departure
     FourthRowState fourth_row_state;                                 // Fourth row - Message-Location/blank
     int ETD_coach_refresh_seconds;                                   // First row - ETD-Coaches
     int third_line_refresh_seconds;                                  // Third row - 2nd-3rd departure
     int Message_Refresh_interval;                                    // Fourth row - Message-Location/blank
-    int refresh_interval_seconds;                                    // Data refresh interval
-    std::chrono::steady_clock::time_point last_first_row_toggle;     // First row - ETD-Coaches
-    std::chrono::steady_clock::time_point last_third_row_toggle;     // Third row - 2nd-3rd departure
     std::chrono::steady_clock::time_point last_fourth_row_toggle;    // Fourth row - Message-Location/blank
-    std::chrono::steady_clock::time_point last_refresh;              // Data refresh
+    
+    // Event scheduling - the render loop sleeps until the earliest event is due (or a new model is published)
+    enum DisplayEvent {
+        SCROLL_TICK,        // Move the scrolling text on - only scheduled while something is scrolling
+        CLOCK_TICK,         // The clock's seconds have changed
+        FIRST_ROW_TOGGLE,   // ETD-Coaches
+        THIRD_ROW_TOGGLE,   // 2nd-3rd departure
+        FOURTH_ROW_CHECK    // Message-Location/blank (a message is only swapped out once it has scrolled through)
+    };
+    struct ScheduledEvent {
+        std::chrono::steady_clock::time_point due;
+        DisplayEvent event;
+        bool operator>(const ScheduledEvent& other) const { return due > other.due; }
+    };
+    std::priority_queue<ScheduledEvent, std::vector<ScheduledEvent>, std::greater<ScheduledEvent>> schedule;
+    FramePacer frame_pacer;                                          // Paces scroll frames and measures frame timing
+    std::unique_ptr<FramePresenter> presenter;                       // Shows frames on its own thread (frame_queue_depth > 0)
+    std::vector<Rect> changed_rects;                                 // What changed in the frame being handed to the presenter
+    std::atomic<bool> frame_stats_requested;                         // Write the frame statistics at the next wake-up
+    std::atomic<bool> refresh_requested;                             // Ask the refresh worker for new data at the next wake-up
+    void writeFrameStats();                                          // Write the frame statistics to frame_stats_path
+    void writeFrameReport(std::ostream& out);                       // Write the pacer, cache and presenter/backend statistics
+    bool scroll_tick_scheduled;                                      // Is a SCROLL_TICK in the schedule
 
     // Helper methods
-    void refreshData();                                                   // get JSON departure data from the API
-    void updateDisplayContent();                                          // Create the content to be displayed
-    void renderFrame();                                                   // Render the data into the matrix display
-    void clearArea(int x_origin, int y_origin, int x_size, int y_size);   // Clear an area on the matrix
+    void refreshData(const std::string& payload);                         // Parse and lay out new API data (worker side)
+    std::shared_ptr<const DisplayModel> buildDisplayModel();              // Lay out the parsed data as a display model
+    void publishDisplayModel(std::shared_ptr<const DisplayModel> built);  // Hand a model to the render loop (worker side)
+    bool adoptDisplayModel();                                             // Pick up a published model (render side, between frames)
+    void renderFrame();                                                   // Redraw the damaged regions, then show them (or hand them to the presenter)
+    Rect regionRect(DisplayRegion region) const;                          // Where a region is on the display
+    void drawRegion(DisplayRegion region, Canvas* target);                // Draw everything in a region
+    bool layerState(DisplayRegion region, int& state) const;              // Is a region static (cacheable) - and in which state
+    void composeRegion(DisplayRegion region, const Rect& area, bool cleared); // Bring a region of the frame buffer up to date
+    void composeThirdRowScroll(const Rect& area);                         // A frame of the 2nd/3rd departure rolling up
+    void stopThirdRowScroll();                                            // Finish (or abandon) the roll
+    void damageRows(unsigned rows);                                       // Damage the regions of DisplayModel rows
 
     // Scrolling functions
-    void renderScrollingCallingPoints();
-    void renderScrollingMessage();
-    void updateScrollPositions();
+    void drawScrollingText(Canvas* target, const Rect& region, const DisplayText& text, const TextStrip& strip, int x);
+    void updateScrollPositions(std::chrono::steady_clock::time_point now);
+    bool isScrolling() const;                                             // Is anything on the display scrolling
+    void updateScrollState(std::chrono::steady_clock::time_point now);    // Start scroll ticks / fix unscrolled text
+    
+    // Event scheduling
+    void scheduleEvent(DisplayEvent event, std::chrono::steady_clock::time_point due);
+    void handleEvent(const ScheduledEvent& scheduled, std::chrono::steady_clock::time_point now);
+    std::chrono::steady_clock::time_point nextClockTick(std::chrono::steady_clock::time_point now) const;
 
     // Toggles for display data
-    void checkFirstRowStateTransition();   // ETD-Coaches
-    void checkThirdRowStateTransition();   // 2nd-3rd departure
     void checkFourthRowStateTransition();  // Message-Location/blank
     void transitionFirstRowState();
     void transitionThirdRowState();
     void transitionFourthRowState();
 
     // Clock display
-    void updateClockDisplay();             // Update the clock
+    int updateClockDisplay();              // Update the clock - returns the first character that changed
+
+    // Scheduling policy and CPUs of each thread (see thread_schedule.h)
+    ThreadSchedule render_thread;
+    ThreadSchedule refresh_thread;
+    ThreadSchedule presenter_thread;
 
-    // For background refresh of API data - this to avoid the display pausing while data refreshes
-    std::thread api_thread;                        // Thread for API calls
-    std::atomic<bool> data_refresh_pending;        // Flag to indicate data refresh is in progress
-    std::atomic<bool> data_refresh_completed;      // Flag to indicate new data is available
-    std::mutex api_data_mutex;                     // Mutex for thread-safe access to API data
-    std::string new_api_data;                      // Buffer for new API data
+    // For background refresh of API data - fetch, parse and layout all happen on the worker so the display never pauses
+    RefreshWorker refresh_worker;                  // Polls the API and calls refreshData with each payload
+    std::mutex model_mutex;                        // Guards pending_model
+    std::condition_variable model_wake;            // Wakes the render loop when a model is published
+    std::shared_ptr<const DisplayModel> pending_model;   // Published by the worker, not yet picked up by the render loop
+    std::atomic<bool> model_published;             // Flag to indicate pending_model is waiting
+    std::shared_ptr<const DisplayModel> built_model;     // The last model the worker built - what new data is compared with
     std::atomic<uint64_t> display_data_version;    // Version control of display data
     std::atomic<uint64_t> api_data_version;        // Version control of api data
     
@@ -163,10 +217,12 @@ private:
     }
 
 public:
-    TrainServiceDisplay(RGBMatrix* m, TrainServiceParser& p, TrainAPIClient& ac, const Config& cfg);
+    TrainServiceDisplay(DisplayBackend& b, TrainServiceParser& p, TrainAPIClient& ac, const Config& cfg);
     ~TrainServiceDisplay(); 
     void run();
     void stop();
+    void requestFrameStats();    // Safe to call from a signal handler
+    void requestRefresh();       // Safe to call from a signal handler
 };
 
 #endif // TRAIN_SERVICE_DISPLAY_H
@@ -8,267 +8,447 @@
 // https://github.com/nlohmann/json
 //
 #include "train_service_parser.h"
+#include "service_filter.h"
+#include "html_decoder.h"
+#include "board_snapshot.h"
+
+namespace {
+
+// Non-throwing access to the departure data
+// Each field is type-checked before it's read, so a missing, null or mis-typed field gives its default
+// rather than a json::type_error - and the normal path has no exception handling at all
+
+// The member 'key' of obj - nullptr if obj isn't an object or doesn't have it
+const arena_json* findField(const arena_json& obj, const char* key) {
+    if (!obj.is_object()) return nullptr;
+    auto it = obj.find(key);
+    return (it == obj.end()) ? nullptr : &(*it);
+}
+
+// The string member 'key' of obj - nullptr if it's missing, null or not a string
+const arena_string* findString(const arena_json& obj, const char* key) {
+    const arena_json* field = findField(obj, key);
+    return (field && field->is_string()) ? &field->get_ref<const arena_string&>() : nullptr;
+}
+
+// Copy the string member 'key' of obj into out, or the fallback if it isn't a string
+// out is assigned in place, so a string reused from the previous board needs no new memory
+// Returns true if the field was present
+bool readString(const arena_json& obj, const char* key, std::string& out, const char* fallback = "") {
+    const arena_string* field = findString(obj, key);
+    if (field) {
+        out.assign(field->data(), field->length());
+        return true;
+    }
+    out.assign(fallback);
+    return false;
+}
+
+// Copy the boolean member 'key' of obj into out, or the fallback if it isn't a boolean
+// Returns true if the field was present
+bool readBool(const arena_json& obj, const char* key, bool& out, bool fallback) {
+    const arena_json* field = findField(obj, key);
+    if (field && field->is_boolean()) {
+        out = field->get<bool>();
+        return true;
+    }
+    out = fallback;
+    return false;
+}
+
+// The non-negative integer member 'key' of obj - 0 if it's missing or not a non-negative integer
+size_t readCount(const arena_json& obj, const char* key) {
+    const arena_json* field = findField(obj, key);
+    if (field && field->is_number_integer() && field->get<long long>() > 0) {
+        return static_cast<size_t>(field->get<long long>());
+    }
+    return 0;
+}
+
+// Copy a string out of a snapshot into out - assigned in place, straight from the mapped file
+void readText(const BoardSnapshot::Text& text, std::string& out) {
+    out.assign(text.data, text.length);
+}
+
+// Add a service to the calling-point index for crs (once, even if it calls twice)
+void addToCallingPointIndex(std::unordered_map<std::string, std::vector<size_t>>& index, const std::string& crs, size_t service_index) {
+    std::vector<size_t>& services_calling = index[crs];
+    if (services_calling.empty() || services_calling.back() != service_index) {
+        services_calling.push_back(service_index);
+    }
+}
+
+// Validity mask - the fields found for a service
+enum ServiceFieldMask : unsigned {
+    FIELD_STD          = 1u << 0,
+    FIELD_DESTINATION  = 1u << 1,
+    FIELD_IS_CANCELLED = 1u << 2,
+};
+
+// A service can't be displayed without a departure time and a destination - it's dropped if either is missing
+const unsigned REQUIRED_FIELDS = FIELD_STD | FIELD_DESTINATION;
+
+} // namespace
 
 TrainServiceParser::TrainServiceParser() : showCallingPointETD(true) {
     showCallingPointETD = true;
     selectPlatform = false;
     ServiceList.fill(999);
     data_version = 1;
+    number_of_services = 0;
+    dropped_services = 0;
 }
 
+// Defined here as ServiceFilter is incomplete in the header
+TrainServiceParser::~TrainServiceParser() = default;
+
 TrainServiceParser::TrainServiceInfo TrainServiceParser::getService(size_t serviceIndex) {
     std::lock_guard<std::mutex> lock(dataMutex);
     
-    try {
-        if (serviceIndex >= number_of_services) {
-            throw std::out_of_range("Service index out of range");
-        }
-        
-        return Services[serviceIndex];
-    } catch (const json::exception& e) {
-        throw std::runtime_error("Error getting service data-structure: " + std::string(e.what()));
+    if (serviceIndex >= number_of_services) {
+        throw std::out_of_range("Service index out of range");
     }
+    
+    return Services[serviceIndex];
 }
 
 void TrainServiceParser::debugPrintServiceStruct(size_t serviceIndex) {
-    try {
-        if (serviceIndex >= number_of_services) {
-            throw std::out_of_range("Service index out of range");
-        }
-        std::cout << "Service: " << serviceIndex << std::endl;
-        
-        std::cout << "scheduledTime: " << Services[serviceIndex].scheduledTime << std::endl;
-        std::cout << "estimatedTime: " << Services[serviceIndex].estimatedTime << std::endl;
-        std::cout << "platform: " << Services[serviceIndex].platform << std::endl;
-        std::cout << "destination: " << Services[serviceIndex].destination << std::endl;
-        std::cout << "callingPoints: " << Services[serviceIndex].callingPoints << std::endl;
-        std::cout << "callingPoints_with_ETD: " << Services[serviceIndex].callingPoints_with_ETD << std::endl;
-        std::cout << "operator_name: " << Services[serviceIndex].operator_name << std::endl;
-        std::cout << "coaches: " << Services[serviceIndex].coaches << std::endl;
-        
-        std::cout << "isCancelled: " << Services[serviceIndex].isCancelled << std::endl;
-        std::cout << "cancelReason: " << Services[serviceIndex].cancelReason << std::endl;
-        
-        std::cout << "isDelayed: " << Services[serviceIndex].isDelayed << std::endl;
-        std::cout << "delayReason: " << Services[serviceIndex].delayReason << std::endl;
-        
-        std::cout << "adhocAlerts: " << Services[serviceIndex].adhocAlerts << std::endl;
-        
-    } catch (const json::exception& e) {
-        throw std::runtime_error("Error printing service data-structure: " + std::string(e.what()));
+    if (serviceIndex >= number_of_services) {
+        throw std::out_of_range("Service index out of range");
     }
+    std::cout << "Service: " << serviceIndex << std::endl;
+    
+    std::cout << "scheduledTime: " << Services[serviceIndex].scheduledTime << std::endl;
+    std::cout << "estimatedTime: " << Services[serviceIndex].estimatedTime << std::endl;
+    std::cout << "platform: " << Services[serviceIndex].platform << std::endl;
+    std::cout << "destination: " << Services[serviceIndex].destination << std::endl;
+    std::cout << "callingPoints: " << Services[serviceIndex].callingPoints << std::endl;
+    std::cout << "callingPoints_with_ETD: " << Services[serviceIndex].callingPoints_with_ETD << std::endl;
+    std::cout << "operator_name: " << Services[serviceIndex].operator_name << std::endl;
+    std::cout << "coaches: " << Services[serviceIndex].coaches << std::endl;
+    
+    std::cout << "isCancelled: " << Services[serviceIndex].isCancelled << std::endl;
+    std::cout << "cancelReason: " << Services[serviceIndex].cancelReason << std::endl;
+    
+    std::cout << "isDelayed: " << Services[serviceIndex].isDelayed << std::endl;
+    std::cout << "delayReason: " << Services[serviceIndex].delayReason << std::endl;
+    
+    std::cout << "adhocAlerts: " << Services[serviceIndex].adhocAlerts << std::endl;
+    
 }
 
 void TrainServiceParser::updateData(const std::string& jsonString) {
-    json new_data;
-    TrainServiceInfo NewServiceInfo;
-    std::vector<TrainServiceInfo> parsed_services;
-    size_t i;
-    size_t coaches;
-    std::stringstream ss;
-    char c;
-    try {
-        new_data = json::parse(jsonString);
-        
-        std::array<size_t, 3> new_service_list;
-        new_service_list.fill(999);
+    // The new board is built in the spare buffers - the table, index and strings of the board before last -
+    // assigning in place so their memory is reused rather than freed and allocated again
+    std::vector<TrainServiceInfo>& parsed_services = spare_services;
+    std::unordered_map<std::string, std::vector<size_t>>& new_calling_point_index = spare_calling_point_index;
+    std::string& new_location_name = spare_location_name;
+    std::string& new_nrcc_message = spare_nrcc_message;
+    size_t parsed = 0;
+    size_t dropped = 0;
+    
+    for (auto& entry : new_calling_point_index) {
+        entry.second.clear();
+    }
+    new_nrcc_message.clear();
+    
+    // The DOM is built in the parse arena, rewound from the last update
+    // (the Scope must outlive new_data - arena memory isn't freed object by object)
+    parse_arena.reset();
+    ParseArena::Scope arena_scope(parse_arena);
+    
+    // Parse without exceptions - a parse error leaves a 'discarded' value
+    const arena_json new_data = arena_json::parse(jsonString, nullptr, false);
+    if (new_data.is_discarded() || !new_data.is_object()) {
+        throw std::runtime_error("Failed to parse JSON: departure data is not a valid JSON object");
+    }
+    
+    // Parse the Meta-data in departure JSON
+    
+    // Services
+    const arena_json* services = findField(new_data, "trainServices");
+    size_t services_in_data = (services && services->is_array()) ? services->size() : 0;
+    DEBUG_PRINT("Parsing data - " << services_in_data << " services in data (DOM " << parse_arena.bytesUsed()
+                << " bytes, arena " << parse_arena.capacity() << " bytes in " << parse_arena.blockCount() << " blocks)");
+    
+    // Location
+    readString(new_data, "locationName", new_location_name);
+    
+    // NRCC messages
+    // Each message is decoded from HTML straight into one reserved buffer
+    const arena_json* messages = findField(new_data, "nrccMessages");
+    if (messages && messages->is_array() && !messages->empty()) {
+        std::vector<const arena_string*, ArenaAllocator<const arena_string*>> message_text;
+        size_t total_length = 0;
         
-        // Parse the Meta-data in departure JSON
+        message_text.reserve(messages->size());
+        for (size_t i = 0; i < messages->size(); ++i) {
+            const arena_json& messageObj = (*messages)[i];
+            
+            // Try both "Value" and "value" field names
+            const arena_string* text = findString(messageObj, "Value");
+            if (!text) {
+                text = findString(messageObj, "value");
+            }
+            if (!text) {
+                DEBUG_PRINT("Message at index " << i << " has neither 'Value' nor 'value' field, or it's null");
+                continue; // Skip this message
+            }
+            message_text.push_back(text);
+            total_length += text->length() + 3;
+        }
         
-        // Number of Services
-        if (new_data.find("trainServices") != new_data.end() &&
-            !new_data["trainServices"].is_null()) {
-            number_of_services = new_data["trainServices"].size();
-        } else {
-            number_of_services =0;
+        new_nrcc_message.reserve(total_length);
+        for (const arena_string* message : message_text) {
+            size_t separator = new_nrcc_message.length();
+            if (separator > 0) new_nrcc_message += " | ";
+            
+            // Strip HTML tags, decode entities and tidy whitespace
+            appendDecodedHtml(message->data(), message->length(), new_nrcc_message);
+            
+            // Drop the separator if the message was empty once decoded
+            if (new_nrcc_message.length() == separator + (separator > 0 ? 3 : 0)) {
+                new_nrcc_message.resize(separator);
+            }
         }
-        DEBUG_PRINT("Parsing data - " << number_of_services << " services in data");
+    }
+    
+    // Parse the Services
+    // Populate the data-structure for all services in departure JSON
+    // Every field is read through the non-throwing helpers with an explicit default.
+    // A service missing a required field (see REQUIRED_FIELDS) is dropped and counted - the rest of the board is kept
+    // Every field of a reused entry is assigned, so nothing is carried over from the older board
+    // Note - the calling-point display strings are lazy-loaded in getCallingPoints
+    for (size_t i = 0; i < services_in_data && parsed < MAX_JSON_SIZE; i++) {
+        const arena_json& service = (*services)[i];
+        if (parsed == parsed_services.size()) {
+            parsed_services.emplace_back();
+        }
+        TrainServiceInfo& NewServiceInfo = parsed_services[parsed];
+        unsigned fields = 0;
         
-        parsed_services.reserve(number_of_services);
+        // scheduledTime
+        if (readString(service, "std", NewServiceInfo.scheduledTime) && !NewServiceInfo.scheduledTime.empty()) {
+            fields |= FIELD_STD;
+        }
         
-        // Location
-        if (new_data.find("locationName") != new_data.end() &&
-            !new_data["locationName"].is_null() &&
-            !new_data["locationName"].empty()) {
-            location_name = new_data["locationName"];
+        // destination and destinationCRS - from the first destination location
+        const arena_json* destination = findField(service, "destination");
+        if (destination && destination->is_array() && !destination->empty()) {
+            if (readString((*destination)[0], "locationName", NewServiceInfo.destination) && !NewServiceInfo.destination.empty()) {
+                fields |= FIELD_DESTINATION;
+            }
+            readString((*destination)[0], "crs", NewServiceInfo.destinationCRS);
         } else {
-            location_name = "";
+            NewServiceInfo.destination.clear();
+            NewServiceInfo.destinationCRS.clear();
         }
         
-        // NRCC messages
-        if (new_data.find("nrccMessages") != new_data.end() &&
-            new_data["nrccMessages"].is_array() &&
-            !new_data["nrccMessages"].empty()) {
-                          
-            for (size_t i = 0; i < new_data["nrccMessages"].size(); ++i) {
-                if (i > 0) ss << " | ";
-                std::string message;
-                const auto& messageObj = new_data["nrccMessages"][i];
-                    
-                // Try both "Value" and "value" field names
-                if (messageObj.contains("Value") && !messageObj["Value"].is_null()) {
-                    message = messageObj["Value"].get<std::string>();
-                    // DEBUG_PRINT("Found NRCC message with 'Value' field (capital V)" );
-                }
-                else if (messageObj.contains("value") && !messageObj["value"].is_null()) {
-                    message = messageObj["value"].get<std::string>();
-                    // DEBUG_PRINT("Found NRCC message with 'value' field (lowercase V");
-                }
-                else {
-                    DEBUG_PRINT("Message at index " << i << " has neither 'Value' nor 'value' field, or it's null");
-                    continue; // Skip this message
-                }
-                    
-                // Process HTML tags
-                message = processHtmlTags(message);
-                // Remove any /n from the beginning of the message
-                c = message[0];
-                if (int(c) == 10) {
-                    message.erase(0,1);
-                }
-                ss << message;
-                }
-            NRCC_message = ss.str();
-        } else {
-            NRCC_message = "";
+        // isCancelled - optional, defaults to false
+        if (readBool(service, "isCancelled", NewServiceInfo.isCancelled, false)) {
+            fields |= FIELD_IS_CANCELLED;
         }
         
-        // Parse the Services
-        // Populate the data=structure for all services in departure JSON
-        // Note - calling-points are lazy-loaded in a separate method
-        // std::string scheduledTime;
-        // std::string estimatedTime;
-        // std::string platform;
-        // std::string destination;
-        // std::string operator_name;
-        // std::string coaches;
-        // bool isCancelled;
-        // bool isDelayed;
-        // std::string cancelReason;
-        // std::string delayReason;
-        // std::string adhocAlerts;
-        // std::string serviceID;
+        if ((fields & REQUIRED_FIELDS) != REQUIRED_FIELDS) {
+            DEBUG_PRINT("Dropping service at index " << i << " -"
+                        << ((fields & FIELD_STD) ? "" : " no 'std'")
+                        << ((fields & FIELD_DESTINATION) ? "" : " no 'destination'"));
+            dropped++;
+            continue;   // The entry is reused by the next service
+        }
         
-        for (i=0; i< number_of_services; i++){
-            // scheduledTime
-            NewServiceInfo.scheduledTime =  new_data["trainServices"][i]["std"].get<std::string>();
-            
-            // estimatedTime
-            if (new_data["trainServices"][i]["etd"].is_null()) {
-                NewServiceInfo.estimatedTime = "null";
-            } else {
-                NewServiceInfo.estimatedTime = new_data["trainServices"][i]["etd"].get<std::string>();
-            }
-            
-            // platform
-            if (new_data["trainServices"][i]["platform"].is_null()) {
-                NewServiceInfo.platform = "";
-            } else {
-                NewServiceInfo.platform = new_data["trainServices"][i]["platform"].get<std::string>();
-            }
-            
-            // destination
-            NewServiceInfo.destination = new_data["trainServices"][i]["destination"][0]["locationName"].get<std::string>();
-            
-            // operator_name
-            if (new_data["trainServices"][i].find("operator") != new_data["trainServices"][i].end() &&
-                !new_data["trainServices"][i]["operator"].is_null() &&
-                !new_data["trainServices"][i]["operator"].get<std::string>().empty()) {
-                NewServiceInfo.operator_name = "A " + new_data["trainServices"][i]["operator"].get<std::string>() + " service";
-            } else {
-                NewServiceInfo.operator_name = "";
-            }
-            
-            // coaches
-            NewServiceInfo.coaches = "";
-            // If coaches exists (NRE data), is not null, and isn't empty
-            if (new_data["trainServices"][i].find("coaches") != new_data["trainServices"][i].end() &&
-                !new_data["trainServices"][i]["coaches"].is_null() &&
-                !new_data["trainServices"][i]["coaches"].get<std::string>().empty()) {
-                NewServiceInfo.coaches = new_data["trainServices"][i]["coaches"].get<std::string>();
-            }
-            
-            // If length exists (Raildata Marketplace), is not 0, and isn't empty, return it
-            if (new_data["trainServices"][i].find("length") != new_data["trainServices"][i].end() &&
-                !new_data["trainServices"][i]["length"].is_null()) {
-                coaches = new_data["trainServices"][i]["length"].get<size_t>();
-                if (coaches !=0) {
-                    NewServiceInfo.coaches = std::to_string(coaches);
-                }
-            }
-            
-            // isCancelled;
-            NewServiceInfo.isCancelled = new_data["trainServices"][i]["isCancelled"].get<bool>();
-            
-            // isDelayed
-            if (NewServiceInfo.estimatedTime != "On time" && NewServiceInfo.estimatedTime != "Cancelled" ) {
-                NewServiceInfo.isDelayed = true;
-            } else {
-                NewServiceInfo.isDelayed = false;
-            }
-            
-            // cancelReason
-            // If cancelReason exists, is not null, and isn't empty
-            if (new_data["trainServices"][i].find("cancelReason") != new_data["trainServices"][i].end() &&
-                !new_data["trainServices"][i]["cancelReason"].is_null() &&
-                !new_data["trainServices"][i]["cancelReason"].get<std::string>().empty()) {
-                NewServiceInfo.cancelReason = new_data["trainServices"][i]["cancelReason"].get<std::string>();
-            } else {
-                NewServiceInfo.cancelReason = ""; // No cancellation or no reason provided
-            }
-            
-            // delayReason
-            // Check if the service is delayed
-            if (NewServiceInfo.estimatedTime != "On time" && NewServiceInfo.estimatedTime != "Cancelled" ) {
-                // If delayReason exists, is not null, and isn't empty, return it
-                if (new_data["trainServices"][i].find("delayReason") != new_data["trainServices"][i].end() &&
-                    !new_data["trainServices"][i]["delayReason"].is_null() &&
-                    !new_data["trainServices"][i]["delayReason"].get<std::string>().empty()) {
-                    NewServiceInfo.delayReason = new_data["trainServices"][i]["delayReason"].get<std::string>();
-                } else {
-                    NewServiceInfo.delayReason = ""; // No reason given
+        // estimatedTime
+        readString(service, "etd", NewServiceInfo.estimatedTime, "null");
+        
+        // platform
+        readString(service, "platform", NewServiceInfo.platform);
+        
+        // callingPointList
+        // The display strings (callingPoints and callingPoints_with_ETD) are lazy-loaded from this in getCallingPoints
+        size_t calling_point_count = 0;
+        const arena_json* subsequent = findField(service, "subsequentCallingPoints");
+        if (subsequent && subsequent->is_array() && !subsequent->empty()) {
+            const arena_json* callingPoints = findField((*subsequent)[0], "callingPoint");
+            if (callingPoints && callingPoints->is_array()) {
+                calling_point_count = callingPoints->size();
+                NewServiceInfo.callingPointList.resize(calling_point_count);
+                
+                for (size_t j = 0; j < calling_point_count; j++) {
+                    const arena_json& point = (*callingPoints)[j];
+                    CallingPoint& NewCallingPoint = NewServiceInfo.callingPointList[j];
+                    readString(point, "locationName", NewCallingPoint.locationName);
+                    if (readString(point, "crs", NewCallingPoint.crs) && !NewCallingPoint.crs.empty()) {
+                        addToCallingPointIndex(new_calling_point_index, NewCallingPoint.crs, parsed);
+                    }
+                    readString(point, "st", NewCallingPoint.scheduledTime);
+                    readString(point, "et", NewCallingPoint.estimatedTime);
                 }
-            } else {
-                NewServiceInfo.delayReason = ""; // No delay
-            }
-            
-            // adhocAlerts
-            // If adhocAlerts exists, is not null, and isn't empty
-            if (new_data["trainServices"][i].find("adhocAlerts") != new_data["trainServices"][i].end() &&
-                !new_data["trainServices"][i]["adhocAlerts"].is_null() &&
-                !new_data["trainServices"][i]["adhocAlerts"].get<std::string>().empty()) {
-                NewServiceInfo.adhocAlerts = new_data["trainServices"][i]["adhocAlerts"].get<std::string>();
-            } else {
-                NewServiceInfo.adhocAlerts = "";
-            }
-            
-            // serviceID
-            // If serviceID exists, is not null, and isn't empty
-            if (new_data["trainServices"][i].find("serviceID") != new_data["trainServices"][i].end() &&
-                !new_data["trainServices"][i]["serviceID"].is_null() &&
-                !new_data["trainServices"][i]["serviceID"].get<std::string>().empty()) {
-                NewServiceInfo.serviceID = new_data["trainServices"][i]["serviceID"].get<std::string>();
-            } else {
-                NewServiceInfo.serviceID = "";
             }
-            
-            // Store the service data
-            parsed_services.push_back(std::move(NewServiceInfo));
         }
+        NewServiceInfo.callingPointList.resize(calling_point_count);
+        NewServiceInfo.callingPoints.clear();
+        NewServiceInfo.callingPoints_with_ETD.clear();
+        
+        // operator_raw, and operator_name made from it for display
+        readString(service, "operator", NewServiceInfo.operator_raw);
+        setOperatorName(NewServiceInfo);
         
-        {
-            std::lock_guard<std::mutex> lock(dataMutex);
-            data = std::move(new_data);
-            ServiceList = std::move(new_service_list);
-            Services.swap(parsed_services);
-            data_version.fetch_add(1, std::memory_order_release);
+        // operatorCode
+        readString(service, "operatorCode", NewServiceInfo.operatorCode);
+        
+        // coaches
+        // 'coaches' is a string in NRE data, 'length' is a number in Raildata Marketplace data (0 if unknown)
+        readString(service, "coaches", NewServiceInfo.coaches);
+        size_t coaches = readCount(service, "length");
+        if (coaches != 0) {
+            NewServiceInfo.coaches = std::to_string(coaches);
         }
         
+        // isDelayed
+        NewServiceInfo.isDelayed = (NewServiceInfo.estimatedTime != "On time" && NewServiceInfo.estimatedTime != "Cancelled");
+        
+        // cancelReason - empty if there's no cancellation or no reason provided
+        readString(service, "cancelReason", NewServiceInfo.cancelReason);
+        
+        // delayReason - only for a delayed service, empty if no reason is given
+        if (NewServiceInfo.isDelayed) {
+            readString(service, "delayReason", NewServiceInfo.delayReason);
+        } else {
+            NewServiceInfo.delayReason.clear();
+        }
+        
+        // adhocAlerts
+        readString(service, "adhocAlerts", NewServiceInfo.adhocAlerts);
+        
+        // serviceID
+        readString(service, "serviceID", NewServiceInfo.serviceID);
+        
+        parsed++;
+    }
+    parsed_services.resize(parsed);
+    
+    if (dropped > 0) {
+        DEBUG_PRINT("Dropped " << dropped << " malformed service(s) - " << parsed << " services kept");
+    }
+    
+    // Forget stations no longer called at, so the index doesn't grow over the day
+    for (auto it = new_calling_point_index.begin(); it != new_calling_point_index.end(); ) {
+        if (it->second.empty()) {
+            it = new_calling_point_index.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    
+    // Encode the snapshot before the new board is published (and the parsed data swapped out)
+    std::string snapshot_file;
+    {
+        std::lock_guard<std::mutex> lock(dataMutex);
+        snapshot_file = snapshot_path;
+    }
+    if (!snapshot_file.empty()) {
+        encodeBoardSnapshot(parsed_services, new_location_name, new_nrcc_message,
+                            data_version.load() + 1, dropped, snapshot_image);
+    }
+    
+    // Swaps the new board in - the spare buffers now hold the previous board, ready for the next update
+    publishBoard(parsed_services, new_calling_point_index, new_location_name, new_nrcc_message, dropped);
+    
+    // A snapshot that can't be written isn't a reason to lose the board
+    if (!snapshot_file.empty()) {
+        try {
+            writeBoardSnapshot(snapshot_file, snapshot_image);
+        } catch (const std::exception& e) {
+            std::cerr << "Error writing board snapshot: " << e.what() << std::endl;
+        }
+    }
+}
+
+void TrainServiceParser::publishBoard(std::vector<TrainServiceInfo>& new_services,
+                                      std::unordered_map<std::string, std::vector<size_t>>& new_calling_point_index,
+                                      std::string& new_location_name,
+                                      std::string& new_nrcc_message,
+                                      size_t dropped) {
+    std::lock_guard<std::mutex> lock(dataMutex);
+    ServiceList.fill(999);
+    Services.swap(new_services);
+    number_of_services = Services.size();
+    dropped_services = dropped;
+    calling_point_index.swap(new_calling_point_index);
+    location_name.swap(new_location_name);
+    NRCC_message.swap(new_nrcc_message);
+    data_version.fetch_add(1, std::memory_order_release);
+}
+
+// operator_name is made from operator_raw for display - filters match on operator_raw
+void TrainServiceParser::setOperatorName(TrainServiceInfo& service) {
+    if (service.operator_raw.empty()) {
+        service.operator_name.clear();
+    } else {
+        service.operator_name.assign("A ").append(service.operator_raw).append(" service");
+    }
+}
+
+// set the file to write a board snapshot to after each update
+void TrainServiceParser::setSnapshotPath(const std::string& path) {
+    std::lock_guard<std::mutex> lock(dataMutex);
+    
+    snapshot_path = path;
+}
+
+// Load the board from a snapshot - the file is mapped and validated, then each field is copied straight out of
+// it into the services (no JSON parse), so the board stays valid after the file is unmapped
+void TrainServiceParser::loadSnapshot(const std::string& path) {
+    BoardSnapshot snapshot(path);   // Throws if the file isn't a valid snapshot
+    
+    std::vector<TrainServiceInfo> loaded_services;
+    std::unordered_map<std::string, std::vector<size_t>> new_calling_point_index;
+    std::string new_location_name;
+    std::string new_nrcc_message;
+    readText(snapshot.locationName(), new_location_name);
+    readText(snapshot.nrccMessage(), new_nrcc_message);
+    
+    size_t count = snapshot.serviceCount() < MAX_JSON_SIZE ? snapshot.serviceCount() : MAX_JSON_SIZE;
+    loaded_services.resize(count);
+    
+    for (size_t i = 0; i < count; i++) {
+        const SnapshotService& record = snapshot.service(i);
+        TrainServiceInfo& service = loaded_services[i];
         
+        readText(snapshot.text(record.scheduledTime), service.scheduledTime);
+        readText(snapshot.text(record.estimatedTime), service.estimatedTime);
+        readText(snapshot.text(record.platform), service.platform);
+        readText(snapshot.text(record.destination), service.destination);
+        readText(snapshot.text(record.destinationCRS), service.destinationCRS);
+        readText(snapshot.text(record.operator_raw), service.operator_raw);
+        setOperatorName(service);
+        readText(snapshot.text(record.operatorCode), service.operatorCode);
+        readText(snapshot.text(record.coaches), service.coaches);
+        readText(snapshot.text(record.cancelReason), service.cancelReason);
+        readText(snapshot.text(record.delayReason), service.delayReason);
+        readText(snapshot.text(record.adhocAlerts), service.adhocAlerts);
+        readText(snapshot.text(record.serviceID), service.serviceID);
+        service.isCancelled = record.isCancelled != 0;
+        service.isDelayed = record.isDelayed != 0;
         
-    } catch (const json::parse_error& e) {
-        throw std::runtime_error("Failed to parse JSON: " + std::string(e.what()));
+        service.callingPointList.resize(record.calling_point_count);
+        for (size_t j = 0; j < record.calling_point_count; j++) {
+            const SnapshotCallingPoint& point = snapshot.callingPoint(record, j);
+            CallingPoint& calling_point = service.callingPointList[j];
+            readText(snapshot.text(point.locationName), calling_point.locationName);
+            readText(snapshot.text(point.crs), calling_point.crs);
+            readText(snapshot.text(point.scheduledTime), calling_point.scheduledTime);
+            readText(snapshot.text(point.estimatedTime), calling_point.estimatedTime);
+            if (!calling_point.crs.empty()) {
+                addToCallingPointIndex(new_calling_point_index, calling_point.crs, i);
+            }
+        }
     }
+    
+    DEBUG_PRINT("Loaded snapshot " << path << " - " << count << " services, written "
+                << (std::time(nullptr) - snapshot.header().created) << "s ago");
+    
+    publishBoard(loaded_services, new_calling_point_index, new_location_name, new_nrcc_message, snapshot.header().dropped_services);
 }
 
 // set the flag to show estimated departure time in calling points
@@ -293,294 +473,319 @@ void TrainServiceParser::unsetSelectedPlatform() {
     selectPlatform = false;
 }
 
+// compile and store a filter expression - only departures matching it will be found
+// An empty expression removes the filter
+void TrainServiceParser::setServiceFilter(const std::string& expression) {
+    std::unique_ptr<ServiceFilter> new_filter;
+    if (!expression.empty()) {
+        new_filter.reset(new ServiceFilter(expression));  // Throws if the expression is invalid
+    }
+    
+    std::lock_guard<std::mutex> lock(dataMutex);
+    service_filter = std::move(new_filter);
+}
+
+// remove the filter
+void TrainServiceParser::unsetServiceFilter() {
+    std::lock_guard<std::mutex> lock(dataMutex);
+    
+    service_filter.reset();
+}
+
+// set the destinations to find departures for - a comma separated list of CRS codes
+// These are matched locally using the calling-point index, so the API call doesn't need to be filtered
+void TrainServiceParser::setDestinationFilter(const std::string& destinations) {
+    std::vector<std::string> new_destinations;
+    std::stringstream ss(destinations);
+    std::string crs;
+    
+    while (std::getline(ss, crs, ',')) {
+        crs.erase(std::remove_if(crs.begin(), crs.end(), [](unsigned char c) { return std::isspace(c); }), crs.end());
+        std::transform(crs.begin(), crs.end(), crs.begin(), [](unsigned char c) { return std::toupper(c); });
+        if (!crs.empty()) {
+            new_destinations.push_back(crs);
+        }
+    }
+    
+    std::lock_guard<std::mutex> lock(dataMutex);
+    destination_filter.swap(new_destinations);
+}
+
+// unset the destination filter
+void TrainServiceParser::unsetDestinationFilter() {
+    std::lock_guard<std::mutex> lock(dataMutex);
+    
+    destination_filter.clear();
+}
+
+// Return the indices of the services calling at a station
+std::vector<size_t> TrainServiceParser::getServicesCallingAt(const std::string& crs) {
+    std::string key = crs;
+    std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return std::toupper(c); });
+    
+    std::lock_guard<std::mutex> lock(dataMutex);
+    
+    auto it = calling_point_index.find(key);
+    if (it == calling_point_index.end()) {
+        return std::vector<size_t>();
+    }
+    return it->second;
+}
+
 // Create a list of departures in the order of when they're going to happen
 // This is by the later of scheduled and estimated time of departure
 void TrainServiceParser::createOrderedDepartureList() {
     std::array<std::time_t, 10> time_list;
     std::string platform;
     
-    try {
-        // Get the number of train services (might be less than 10)
+    // Get the number of train services (might be less than 10)
+    
+    // Get current time to use for date information (localtime_r - this runs on the refresh worker while the display uses the clock)
+    std::time_t now = std::time(nullptr);
+    std::tm now_tm;
+    localtime_r(&now, &now_tm);
+    
+    // Fill time_list with departure times
+    for (size_t i = 0; i < number_of_services; i++) {
+        std::tm departure_time = now_tm; // Start with today's date
+        std::string time_str;
         
-        // Get current time to use for date information
-        std::time_t now = std::time(nullptr);
-        std::tm *now_tm = std::localtime(&now);
+        // Parse the scheduled time
+        //time_str = data["trainServices"][i]["std"].get<std::string>();
+        time_str = Services[i].scheduledTime;
+        int hours, minutes;
+        if (sscanf(time_str.c_str(), "%d:%d", &hours, &minutes) == 2) {
+            departure_time.tm_hour = hours;
+            departure_time.tm_min = minutes;
+            departure_time.tm_sec = 0; // Reset seconds
+        }
         
-        // Fill time_list with departure times
-        for (size_t i = 0; i < number_of_services; i++) {
-            std::tm departure_time = *now_tm; // Start with today's date
-            std::string time_str;
-            
-            // Parse the scheduled time
-            //time_str = data["trainServices"][i]["std"].get<std::string>();
-            time_str = Services[i].scheduledTime;
-            int hours, minutes;
-            if (sscanf(time_str.c_str(), "%d:%d", &hours, &minutes) == 2) {
+        std::time_t td_time = mktime(&departure_time);
+        
+        // Check if there's an estimated time and use it if it's not "On Time" or "Cancelled"
+        std::string etd = Services[i].estimatedTime;
+        
+        if (!(etd == "On Time" || etd == "On time" || etd == "Cancelled" || etd == "null")) {
+            // It's an actual time, parse it
+            departure_time = now_tm; // Reset with today's date
+            if (sscanf(etd.c_str(), "%d:%d", &hours, &minutes) == 2) {
                 departure_time.tm_hour = hours;
                 departure_time.tm_min = minutes;
                 departure_time.tm_sec = 0; // Reset seconds
+                td_time = mktime(&departure_time);
             }
+        }
+        
+        time_list[i] = td_time;
+    }
+    
+    // Uncomment the next code block for a dump of the unsorted departure times 
+    /* if (debug_mode) {
+        DEBUG_PRINT("----- list of departure times -----");
+        for (size_t i = 0; i < number_of_services; i++) {
+            // Format time as HH:MM for easier reading
+            std::tm* tm_time = localtime(&time_list[i]);
+            char buffer[10];
+            strftime(buffer, sizeof(buffer), "%H:%M", tm_time);
             
-            std::time_t td_time = mktime(&departure_time);
-            
-            // Check if there's an estimated time and use it if it's not "On Time" or "Cancelled"
-            std::string etd = Services[i].estimatedTime;
-            
-            if (!(etd == "On Time" || etd == "On time" || etd == "Cancelled" || etd == "null")) {
-                // It's an actual time, parse it
-                departure_time = *now_tm; // Reset with today's date
-                if (sscanf(etd.c_str(), "%d:%d", &hours, &minutes) == 2) {
-                    departure_time.tm_hour = hours;
-                    departure_time.tm_min = minutes;
-                    departure_time.tm_sec = 0; // Reset seconds
-                    td_time = mktime(&departure_time);
-                }
-            }
+            platform = Services[i].platform;
             
-            time_list[i] = td_time;
+            DEBUG_PRINT("Element " << i << " of time_list array. Platform " << platform << " Departure time " << buffer << " derived from" <<
+                        //" std: " << data["trainServices"][i]["std"].get<std::string>() <<
+                        //" etd: " << data["trainServices"][i]["etd"].get<std::string>());
+                        " std: " << Services[i].scheduledTime <<
+                        " etd: " << Services[i].estimatedTime);
         }
-        
-        // Uncomment the next code block for a dump of the unsorted departure times 
-        /* if (debug_mode) {
-            DEBUG_PRINT("----- list of departure times -----");
-            for (size_t i = 0; i < number_of_services; i++) {
-                // Format time as HH:MM for easier reading
-                std::tm* tm_time = localtime(&time_list[i]);
-                char buffer[10];
-                strftime(buffer, sizeof(buffer), "%H:%M", tm_time);
-                
-                platform = Services[i].platform;
-                
-                DEBUG_PRINT("Element " << i << " of time_list array. Platform " << platform << " Departure time " << buffer << " derived from" <<
-                            //" std: " << data["trainServices"][i]["std"].get<std::string>() <<
-                            //" etd: " << data["trainServices"][i]["etd"].get<std::string>());
-                            " std: " << Services[i].scheduledTime <<
-                            " etd: " << Services[i].estimatedTime);
-            }
-            if (number_of_services == 0) {
-                DEBUG_PRINT("No train services available");
-            }
-        } */
+        if (number_of_services == 0) {
+            DEBUG_PRINT("No train services available");
+        }
+    } */
 
 
-        
-        // Initialize ETDOrderedList for actual number of services
+    
+    // Initialize ETDOrderedList for actual number of services
+    for (size_t i = 0; i < number_of_services; i++) {
+        ETDOrderedList[i] = i;
+    }
+    
+    // Fill the rest with invalid indices if num_services < 10
+    for (size_t i = number_of_services; i < 10; i++) {
+        ETDOrderedList[i] = 999; // Use 999 as an invalid index
+    }
+    
+    // Sort only the valid indices based on time values (from earliest to latest)
+    if (number_of_services > 0) {
+        std::sort(ETDOrderedList.begin(), ETDOrderedList.begin() + number_of_services,
+                  [&time_list](size_t a, size_t b) {
+            return time_list[a] < time_list[b];
+        });
+    }
+    
+    // Debug output for only valid services
+    if (debug_mode) {
+        DEBUG_PRINT("----- Indices of departures in time order -----");
         for (size_t i = 0; i < number_of_services; i++) {
-            ETDOrderedList[i] = i;
-        }
-        
-        // Fill the rest with invalid indices if num_services < 10
-        for (size_t i = number_of_services; i < 10; i++) {
-            ETDOrderedList[i] = 999; // Use 999 as an invalid index
-        }
-        
-        // Sort only the valid indices based on time values (from earliest to latest)
-        if (number_of_services > 0) {
-            std::sort(ETDOrderedList.begin(), ETDOrderedList.begin() + number_of_services,
-                      [&time_list](size_t a, size_t b) {
-                return time_list[a] < time_list[b];
-            });
+            size_t idx = ETDOrderedList[i];
+            // Format time as HH:MM
+            std::tm tm_time;
+            localtime_r(&time_list[idx], &tm_time);
+            char buffer[10];
+            strftime(buffer, sizeof(buffer), "%H:%M", &tm_time);
+            
+            DEBUG_PRINT("Position: " << i << " Index: " << idx << " Platform: " << Services[idx].platform <<
+                       " Departure time: " << buffer << " derived from" <<
+                        " std: " << Services[idx].scheduledTime <<
+                        " etd: " << Services[idx].estimatedTime);
         }
-        
-        // Debug output for only valid services
-        if (debug_mode) {
-            DEBUG_PRINT("----- Indices of departures in time order -----");
-            for (size_t i = 0; i < number_of_services; i++) {
-                size_t idx = ETDOrderedList[i];
-                // Format time as HH:MM
-                std::tm* tm_time = localtime(&time_list[idx]);
-                char buffer[10];
-                strftime(buffer, sizeof(buffer), "%H:%M", tm_time);
-                
-                DEBUG_PRINT("Position: " << i << " Index: " << idx << " Platform: " << Services[idx].platform <<
-                           " Departure time: " << buffer << " derived from" <<
-                            " std: " << Services[idx].scheduledTime <<
-                            " etd: " << Services[idx].estimatedTime);
-            }
-            if (number_of_services == 0) {
-                DEBUG_PRINT("No train services available");
-            }
-            DEBUG_PRINT(" ");
+        if (number_of_services == 0) {
+            DEBUG_PRINT("No train services available");
         }
-    } catch (const json::exception& e) {
-        throw std::runtime_error("Error creating ordered list of departure times: " + std::string(e.what()));
+        DEBUG_PRINT(" ");
     }
 }
 
 // Get the indices of the first three departures
 // If a platform of selected then limit departures to that platform
+// If destinations are set then limit departures to those calling at one of them
+// If a filter is set then limit departures to those matching the filter
 void TrainServiceParser::findServices() {
     size_t i;
     size_t index;
     
-    try {
-        // Check if train services exist in the data
-        if (number_of_services == 0) {
-            DEBUG_PRINT("No train services found in the data");
-            return;
+    // Check if train services exist in the data
+    if (number_of_services == 0) {
+        DEBUG_PRINT("No train services found in the data");
+        return;
+    }
+    
+    // Clear saved services
+    ServiceList.fill(999);
+    
+    // Get ordered list of departures
+    createOrderedDepartureList();
+    
+    // Mark the services calling at any of the filtered destinations - one index lookup per destination
+    if (!destination_filter.empty()) {
+        calls_at_destination.assign(number_of_services, 0);
+        for (const auto& crs : destination_filter) {
+            auto it = calling_point_index.find(crs);
+            if (it != calling_point_index.end()) {
+                for (size_t service_index : it->second) {
+                    calls_at_destination[service_index] = 1;
+                }
+            }
         }
+    }
+    
+    // Find the first 3 departures in a single pass of the ordered list
+    // Skip any not on the selected platform, not calling at the destination or not matching the filter (if set)
+    size_t serviceCount = 0;
+    
+    if (selectPlatform) {
+        DEBUG_PRINT("Searching for services at platform " << selected_platform);
+    }
+    
+    for (i = 0; i < number_of_services && serviceCount < ServiceList.size(); ++i) {
+        index = ETDOrderedList[i];
         
-        // Clear saved services
-        ServiceList.fill(999);
-        
-        // Get ordered list of departures
-        createOrderedDepartureList();
+        if (selectPlatform && Services[index].platform != selected_platform) {
+            continue;
+        }
+        if (!destination_filter.empty() && !calls_at_destination[index]) {
+            continue;
+        }
+        if (service_filter && !service_filter->matches(Services[index])) {
+            continue;
+        }
         
+        ServiceList[serviceCount] = index;
+        ++serviceCount;
+    }
+
+    // Debug information about the found service
+    if (debug_mode) {
         if (selectPlatform) {
-            // Find departures for the selected platform
-            size_t serviceCount = 0;
-            
-            DEBUG_PRINT("Searching for services at platform " << selected_platform);
-            
-            // Iterate through all train services
-            for (i = 0; i < number_of_services && serviceCount < ServiceList.size(); ++i) {
-                index = ETDOrderedList[i];
-                //const auto& service = data["trainServices"][index];
-                
-                // Check if the platform matches the selected platform
-                if (Services[index].platform == selected_platform) {
-                    // Found a service for the selected platform, add its index to the array
-                    DEBUG_PRINT("Found service for platform " << selected_platform << " at position " << index);
-                    ServiceList[serviceCount] = index;
-                    
-                    // Increment the count of services found
-                    ++serviceCount;
-                }
-            }
+            DEBUG_PRINT("Finding the first 3 departures for platform " << selected_platform);
         } else {
-            // Find the first 3 departures
-            for (i = 0; i < 3; i++) {
-                if (i < number_of_services) {
-                    ServiceList[i] = ETDOrderedList[i];
-                }
-            }
+            DEBUG_PRINT("Finding the first 3 departures ");
         }
-
-        // Debug information about the found service
-        if (debug_mode) {
-            if (selectPlatform) {
-                DEBUG_PRINT("Finding the first 3 departures for platform " << selected_platform);
-            } else {
-                DEBUG_PRINT("Finding the first 3 departures ");
-            }
-            for (i=0; i < 3; i++) {
-                index = ServiceList[i];
-                if ( ServiceList[i] == 999) {
-                    DEBUG_PRINT("Index " << i << " - Service " << index <<". No service found");
-                } else {
-                    DEBUG_PRINT("Index " << i << " - Service " << index << " Platform " << Services[index].platform
-                                << "    Destination: " << Services[index].destination
-                                << " - Scheduled departure: " << Services[index].scheduledTime
-                                << " - Estimated departure: " << Services[index].estimatedTime);
-                }
-            }
+        for (const auto& crs : destination_filter) {
+            DEBUG_PRINT("Calling at destination: " << crs);
         }
-    } catch (const json::exception& e) {
-        DEBUG_PRINT("Error finding services: " << e.what());
-    }
-}
-
-// Stop HTML code being included in the NRCC messages
-std::string TrainServiceParser::processHtmlTags(const std::string& html) {
-    std::string result;
-    bool inTag = false;
-    for (size_t i = 0; i < html.length(); ++i) {
-        if (html[i] == '<') {
-            inTag = true;
-        } else if (html[i] == '>') {
-            inTag = false;
-        } else if (!inTag) {
-            // Handle HTML entity for quotes
-            if (i + 5 < html.length() && html.substr(i, 5) == "&quot;") {
-                result += "\"";
-                i += 4; // Skip the entity (& is already processed)
-            } else if (i + 4 < html.length() && html.substr(i, 4) == "&lt;") {
-                result += "<";
-                i += 3; // Skip the entity
-            } else if (i + 4 < html.length() && html.substr(i, 4) == "&gt;") {
-                result += ">";
-                i += 3; // Skip the entity
-            } else if (i + 5 < html.length() && html.substr(i, 5) == "&amp;") {
-                result += "&";
-                i += 4; // Skip the entity
-            } else if (i + 2 < html.length() && html.substr(i, 2) == "\n") {
-                result += "";
-                i += 1; // Skip the entity
+        if (service_filter) {
+            DEBUG_PRINT("Using filter: " << service_filter->getExpression());
+        }
+        for (i=0; i < 3; i++) {
+            index = ServiceList[i];
+            if ( ServiceList[i] == 999) {
+                DEBUG_PRINT("Index " << i << " - Service " << index <<". No service found");
             } else {
-                result += html[i];
+                DEBUG_PRINT("Index " << i << " - Service " << index << " Platform " << Services[index].platform
+                            << "    Destination: " << Services[index].destination
+                            << " - Scheduled departure: " << Services[index].scheduledTime
+                            << " - Estimated departure: " << Services[index].estimatedTime);
             }
         }
     }
-    return result;
 }
 
 // Lazy-load the calling points for the selected service into the data-structure
 std::string TrainServiceParser::getCallingPoints(size_t serviceIndex) {
     std::lock_guard<std::mutex> lock(dataMutex);
-    try {
-        if (serviceIndex >= number_of_services) {
-            throw std::out_of_range("Service index out of range");
-        }
-        const auto& service = data["trainServices"][serviceIndex];
-        const auto& callingPoints = service["subsequentCallingPoints"][0]["callingPoint"];
-        
-        // There are no calling points then set output appropriately,
-        if ( callingPoints.size() == 0) {
-            Services[serviceIndex].callingPoints_with_ETD = "No calling points available";
-            Services[serviceIndex].callingPoints = "No calling points available";
-            return "No calling points available";
-        }
-        
-        // If we're showing calling points, return the stored parsed calling points
-        
-        // Return calling points with the Time of Departures is we're showing the time of departure from each calling point.
-        if (showCallingPointETD) {
-            // Check if we have this stored already - generate the content and store it if we don't
-            if(Services[serviceIndex].callingPoints_with_ETD == "") {
-                std::stringstream ss;
-                for (size_t i = 0; i < callingPoints.size(); ++i) {
-                    if (i > 0) ss << ", ";
-                    ss << callingPoints[i]["locationName"].get<std::string>();
+    if (serviceIndex >= number_of_services) {
+        throw std::out_of_range("Service index out of range");
+    }
+    const auto& callingPoints = Services[serviceIndex].callingPointList;
+    
+    // There are no calling points then set output appropriately,
+    if ( callingPoints.size() == 0) {
+        Services[serviceIndex].callingPoints_with_ETD = "No calling points available";
+        Services[serviceIndex].callingPoints = "No calling points available";
+        return "No calling points available";
+    }
+    
+    // If we're showing calling points, return the stored parsed calling points
+    
+    // Return calling points with the Time of Departures is we're showing the time of departure from each calling point.
+    if (showCallingPointETD) {
+        // Check if we have this stored already - generate the content and store it if we don't
+        // The text is built in place - the string keeps its memory from the last board
+        std::string& text = Services[serviceIndex].callingPoints_with_ETD;
+        if (text.empty()) {
+            for (size_t i = 0; i < callingPoints.size(); ++i) {
+                if (i > 0) text += ", ";
+                text += callingPoints[i].locationName;
+                
+                // Check if 'et' is not empty
+                if (!callingPoints[i].estimatedTime.empty()) {
                     
-                    // Check if 'et' exists, is not null, and is not empty
-                    if (callingPoints[i].find("et") != callingPoints[i].end() &&
-                        !callingPoints[i]["et"].is_null() &&
-                        !callingPoints[i]["et"].get<std::string>().empty()) {
-                        
-                        // Get the estimated time
-                        std::string etValue = callingPoints[i]["et"].get<std::string>();
-                        
-                        if (etValue == "On time") {
-                            // If the train is on time, display the scheduled time instead
-                            if (callingPoints[i].find("st") != callingPoints[i].end() &&
-                                !callingPoints[i]["st"].is_null() &&
-                                !callingPoints[i]["st"].get<std::string>().empty()) {
-                                ss << " (" << callingPoints[i]["st"].get<std::string>() << ")";
-                            }
-                        } else {
-                            // For any other value (delayed, etc.), display the estimated time
-                            ss << " (" << etValue << ")";
+                    if (callingPoints[i].estimatedTime == "On time") {
+                        // If the train is on time, display the scheduled time instead
+                        if (!callingPoints[i].scheduledTime.empty()) {
+                            text += " (";
+                            text += callingPoints[i].scheduledTime;
+                            text += ")";
                         }
+                    } else {
+                        // For any other value (delayed, etc.), display the estimated time
+                        text += " (";
+                        text += callingPoints[i].estimatedTime;
+                        text += ")";
                     }
                 }
-                Services[serviceIndex].callingPoints_with_ETD = ss.str();
             }
-            return Services[serviceIndex].callingPoints_with_ETD;
-        } else { // Return calling points without the Time of Departure
-            // Check if we have this stored - generate the content and store it if we don't
-            if (Services[serviceIndex].callingPoints == "" ) {
-                std::stringstream ss;
-                for (size_t i = 0; i < callingPoints.size(); ++i) {
-                    if (i > 0) ss << ", ";
-                    ss << callingPoints[i]["locationName"].get<std::string>();
-                }
-                Services[serviceIndex].callingPoints = ss.str();
+        }
+        return text;
+    } else { // Return calling points without the Time of Departure
+        // Check if we have this stored - generate the content and store it if we don't
+        std::string& text = Services[serviceIndex].callingPoints;
+        if (text.empty()) {
+            for (size_t i = 0; i < callingPoints.size(); ++i) {
+                if (i > 0) text += ", ";
+                text += callingPoints[i].locationName;
             }
-            return Services[serviceIndex].callingPoints;
         }
-    } catch (const json::exception& e) {
-        DEBUG_PRINT(data);
-        throw std::runtime_error("Error creating calling points: " + std::string(e.what()));
+        return text;
     }
 }
 
@@ -608,6 +813,12 @@ size_t TrainServiceParser::getNumberOfServices() {
         return number_of_services;
 }
 
+size_t TrainServiceParser::getNumberOfDroppedServices() {
+    std::lock_guard<std::mutex> lock(dataMutex);
+    
+    return dropped_services;
+}
+
 std::string TrainServiceParser::getSelectedPlatform() {
     std::lock_guard<std::mutex> lock(dataMutex);
     if (selectPlatform) {
@@ -621,187 +832,134 @@ std::string TrainServiceParser::getSelectedPlatform() {
 std::tuple<std::string, std::string, std::string, std::string, std::string, std::string, bool> TrainServiceParser::getBasicServiceInfo(size_t serviceIndex) {
     std::lock_guard<std::mutex> lock(dataMutex);
     
-    try {
-        if (serviceIndex >= number_of_services) {
-            throw std::out_of_range("Service index out of range");
-        }
-        return std::make_tuple(
-                               Services[serviceIndex].destination,
-                               Services[serviceIndex].scheduledTime,
-                               Services[serviceIndex].estimatedTime,
-                               Services[serviceIndex].platform,
-                               Services[serviceIndex].coaches,
-                               Services[serviceIndex].operator_name,
-                               Services[serviceIndex].isCancelled
-                               );
-    }
-    catch (const json::exception& e) {
-        throw std::runtime_error("Error getting Tuple of destination, std, etd, platform, coaches, operator, cancelled: " + std::string(e.what()));
+    if (serviceIndex >= number_of_services) {
+        throw std::out_of_range("Service index out of range");
     }
+    return std::make_tuple(
+                           Services[serviceIndex].destination,
+                           Services[serviceIndex].scheduledTime,
+                           Services[serviceIndex].estimatedTime,
+                           Services[serviceIndex].platform,
+                           Services[serviceIndex].coaches,
+                           Services[serviceIndex].operator_name,
+                           Services[serviceIndex].isCancelled
+                           );
 }
 
 std::string TrainServiceParser::getScheduledDepartureTime(size_t serviceIndex) {
     std::lock_guard<std::mutex> lock(dataMutex);
     
-    try {
-        if (serviceIndex >= number_of_services) {
-            throw std::out_of_range("Service index out of range");
-        }
-        return Services[serviceIndex].scheduledTime;
-    } catch (const json::exception& e) {
-        throw std::runtime_error("Error getting Scheduled Departure Time: " + std::string(e.what()));
+    if (serviceIndex >= number_of_services) {
+        throw std::out_of_range("Service index out of range");
     }
+    return Services[serviceIndex].scheduledTime;
 }
 
 
 std::string TrainServiceParser::getEstimatedDepartureTime(size_t serviceIndex) {
     std::lock_guard<std::mutex> lock(dataMutex);
     
-    try {
-        if (serviceIndex >= number_of_services) {
-            throw std::out_of_range("Service index out of range");
-        }
-        return Services[serviceIndex].estimatedTime;
-    } catch (const json::exception& e) {
-        throw std::runtime_error("Error getting Estimated Departure Time: " + std::string(e.what()));
+    if (serviceIndex >= number_of_services) {
+        throw std::out_of_range("Service index out of range");
     }
+    return Services[serviceIndex].estimatedTime;
 }
 
 std::string TrainServiceParser::getPlatform(size_t serviceIndex) {
     std::lock_guard<std::mutex> lock(dataMutex);
     
-    try {
-        if (serviceIndex >= number_of_services) {
-            throw std::out_of_range("Service index out of range");
-        }
-        return Services[serviceIndex].platform;
-    } catch (const json::exception& e) {
-        throw std::runtime_error("Error getting Platform: " + std::string(e.what()));
+    if (serviceIndex >= number_of_services) {
+        throw std::out_of_range("Service index out of range");
     }
+    return Services[serviceIndex].platform;
 }
 
 std::string TrainServiceParser::getDestination(size_t serviceIndex) {
     std::lock_guard<std::mutex> lock(dataMutex);
     
-    try {
-        if (serviceIndex >= number_of_services) {
-            throw std::out_of_range("Service index out of range");
-        }
-        return Services[serviceIndex].destination;
-    } catch (const json::exception& e) {
-        throw std::runtime_error("Error getting Destination: " + std::string(e.what()));
+    if (serviceIndex >= number_of_services) {
+        throw std::out_of_range("Service index out of range");
     }
+    return Services[serviceIndex].destination;
 }
 
 bool TrainServiceParser::isCancelled(size_t serviceIndex) {
     std::lock_guard<std::mutex> lock(dataMutex);
     
-    try {
-        if (serviceIndex >= number_of_services) {
-            throw std::out_of_range("Service index out of range");
-        }
-        return Services[serviceIndex].isCancelled;
-    } catch (const json::exception& e) {
-        throw std::runtime_error("Error getting Cancellation status: " + std::string(e.what()));
+    if (serviceIndex >= number_of_services) {
+        throw std::out_of_range("Service index out of range");
     }
+    return Services[serviceIndex].isCancelled;
 }
 
 std::string TrainServiceParser::getCancelReason(size_t serviceIndex) {
     std::lock_guard<std::mutex> lock(dataMutex);
     
-    try {
-        if (serviceIndex >= number_of_services) {
-            throw std::out_of_range("Service index out of range");
-        }
-        return Services[serviceIndex].cancelReason;
-    } catch (const json::exception& e) {
-        throw std::runtime_error("Error getting Cancellation reason: " + std::string(e.what()));
+    if (serviceIndex >= number_of_services) {
+        throw std::out_of_range("Service index out of range");
     }
+    return Services[serviceIndex].cancelReason;
 }
 
 bool TrainServiceParser::isDelayed(size_t serviceIndex) {
     std::lock_guard<std::mutex> lock(dataMutex);
     
-    try {
-        if (serviceIndex >= number_of_services) {
-            throw std::out_of_range("Service index out of range");
-        }
-        return Services[serviceIndex].isDelayed;
-    } catch (const json::exception& e) {
-        throw std::runtime_error("Error getting delay status: " + std::string(e.what()));
+    if (serviceIndex >= number_of_services) {
+        throw std::out_of_range("Service index out of range");
     }
+    return Services[serviceIndex].isDelayed;
 }
 
 std::string TrainServiceParser::getDelayReason(size_t serviceIndex) {
     std::lock_guard<std::mutex> lock(dataMutex);
     
-    try {
-        if (serviceIndex >= number_of_services) {
-            throw std::out_of_range("Service index out of range");
-        }
-        return Services[serviceIndex].delayReason;
-    } catch (const json::exception& e) {
-        throw std::runtime_error("Error getting delay reason: " + std::string(e.what()));
+    if (serviceIndex >= number_of_services) {
+        throw std::out_of_range("Service index out of range");
     }
+    return Services[serviceIndex].delayReason;
 }
 
 std::string TrainServiceParser::getadhocAlerts(size_t serviceIndex){
     std::lock_guard<std::mutex> lock(dataMutex);
     
-    try {
-        if (serviceIndex >= number_of_services) {
-            throw std::out_of_range("Service index out of range");
-        }
-        return Services[serviceIndex].adhocAlerts;
-    } catch (const json::exception& e) {
-        throw std::runtime_error("Error getting adhoc alerts: " + std::string(e.what()));
+    if (serviceIndex >= number_of_services) {
+        throw std::out_of_range("Service index out of range");
     }
+    return Services[serviceIndex].adhocAlerts;
 }
 
 std::string TrainServiceParser::getserviceID(size_t serviceIndex) {
     std::lock_guard<std::mutex> lock(dataMutex);
     
-    try {
-        if (serviceIndex >= number_of_services) {
-            throw std::out_of_range("Service index out of range");
-        }
-        return Services[serviceIndex].serviceID;
-    } catch (const json::exception& e) {
-        throw std::runtime_error("Error getting serviceID: " + std::string(e.what()));
+    if (serviceIndex >= number_of_services) {
+        throw std::out_of_range("Service index out of range");
     }
+    return Services[serviceIndex].serviceID;
 }
 
 
 std::string TrainServiceParser::getCoaches(size_t serviceIndex, bool addText) {
     std::lock_guard<std::mutex> lock(dataMutex);
     
-    try {
-        if (serviceIndex >= number_of_services) {
-            throw std::out_of_range("Service index out of range");
-        }
-        std::string text = Services[serviceIndex].coaches;
-        if (!text.empty()) {
-            if (addText) {
-                text = " formed of " + text + " coaches";
-            }
+    if (serviceIndex >= number_of_services) {
+        throw std::out_of_range("Service index out of range");
+    }
+    std::string text = Services[serviceIndex].coaches;
+    if (!text.empty()) {
+        if (addText) {
+            text = " formed of " + text + " coaches";
         }
-        return text;
-    } catch (const json::exception& e) {
-        throw std::runtime_error("Error getting number of coaches: " + std::string(e.what()));
     }
+    return text;
 }
 
 std::string TrainServiceParser::getOperator(size_t serviceIndex) {
     std::lock_guard<std::mutex> lock(dataMutex);
     
-    try {
-        if (serviceIndex >= number_of_services) {
-            throw std::out_of_range("Service index out of range");
-        }
-        return Services[serviceIndex].operator_name;
-    } catch (const json::exception& e) {
-        throw std::runtime_error("Error getting operator name: " + std::string(e.what()));
+    if (serviceIndex >= number_of_services) {
+        throw std::out_of_range("Service index out of range");
     }
+    return Services[serviceIndex].operator_name;
 }
 
 std::string TrainServiceParser::getNrccMessages() {
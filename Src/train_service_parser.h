@@ -24,6 +24,12 @@
 #include <atomic>
 #include <ctime>
 #include <tuple>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cctype>
+#include "parse_arena.h"
 
 using json = nlohmann::json;
 
@@ -32,19 +38,33 @@ extern bool debug_mode;
 #define DEBUG_PRINT(x) if(debug_mode) { std::cerr << x << std::endl; }
 #define DEBUG_PRINT_JSON(x) if(debug_mode) { std::cerr << std::setw(4) << x << std::endl; }
 
+class ServiceFilter;
+
 class TrainServiceParser {
     
 public:
     TrainServiceParser();                                       //Constructor
+    ~TrainServiceParser();                                      //Destructor
+    
+    struct CallingPoint {                                       // Calling point data-structure
+        std::string locationName;
+        std::string crs;
+        std::string scheduledTime;
+        std::string estimatedTime;
+    };
     
     struct TrainServiceInfo {                                   // Train service data-structure
         std::string scheduledTime;
         std::string estimatedTime;
         std::string platform;
         std::string destination;
+        std::string destinationCRS;
+        std::vector<CallingPoint> callingPointList;
         std::string callingPoints;
         std::string callingPoints_with_ETD;
-        std::string operator_name;
+        std::string operator_name;                              // "A <operator> service", for display
+        std::string operator_raw;                               // The operator as the API gives it
+        std::string operatorCode;
         std::string coaches;
         bool isCancelled;
         bool isDelayed;
@@ -65,15 +85,23 @@ public:
     void setSelectedPlatform(const std::string& platform);       // Set a specific platform - departures will be found for that platform
     std::string getSelectedPlatform();                           // Get the selected platform
     void unsetSelectedPlatform();                                // Unset the selected platform - departures will be found for all platforms
+    void setServiceFilter(const std::string& expression);        // Compile a filter expression - only matching departures will be found
+    void unsetServiceFilter();                                   // Remove the filter - departures will be found for all services
+    void setDestinationFilter(const std::string& destinations);  // Set destination CRS codes (comma separated) - only departures calling at one of them will be found
+    void unsetDestinationFilter();                               // Unset the destination filter - departures will be found for all destinations
+    std::vector<size_t> getServicesCallingAt(const std::string& crs);  // Return the indices of services calling at a station (from the calling-point index)
     void updateData(const std::string& jsonString);              // Update with new JSON data
+    void setSnapshotPath(const std::string& path);               // Write a binary snapshot of the board to this file after each update (empty for none)
+    void loadSnapshot(const std::string& path);                  // Load the board from a binary snapshot file (throws if it isn't valid)
     void createOrderedDepartureList();                           // Create an array of indices in order of departure time (STD and ETD - whichever is later)
     
-    void findServices();                                         // Find the next 3 services - takes into account whether a specific platform has been set
+    void findServices();                                         // Find the next 3 services - takes into account the selected platform and filter
 
     bool isCancelled(size_t serviceIndex);                       // Yes/No - is the specified departure cancelled
     bool isDelayed(size_t serviceIndex);                         // Yes/No - is the specified departure delayed
 
-    size_t getNumberOfServices();                                // Return the number of Services in the JSON
+    size_t getNumberOfServices();                                // Return the number of Services in the JSON (excluding any dropped as malformed)
+    size_t getNumberOfDroppedServices();                         // Return the number of Services dropped from the JSON as malformed
     size_t getFirstDeparture();                                  // Return the index for the first departure
     size_t getSecondDeparture();                                 // Return the index for the second departure
     size_t getThirdDeparture();                                  // Return the index for the third departure
@@ -97,13 +125,18 @@ public:
     std::string getserviceID(size_t serviceIndex);               // Return the serviceID for the selected service
     
 private:
-    // Helper method to strip HTML tags from text
-    std::string processHtmlTags(const std::string& html);
-    
     // Parsing and parsed data
-    json data;                                  // JSON data
     std::vector<TrainServiceInfo> Services;     // Parsed data - vector of Services
     
+    // Double-buffering for updateData - the next board is parsed into the previous board's buffers
+    // and swapped with the current one, so the memory is reused rather than reallocated on every refresh
+    // Only updateData (on one thread at a time) uses these, so they aren't protected by dataMutex
+    ParseArena parse_arena;                     // Memory for the JSON DOM - rewound for each update
+    std::vector<TrainServiceInfo> spare_services;
+    std::unordered_map<std::string, std::vector<size_t>> spare_calling_point_index;
+    std::string spare_location_name;
+    std::string spare_nrcc_message;
+    
     // Configuration and process management
     static const size_t MAX_JSON_SIZE = 10;     // Max number of Services in JSON data
     std::mutex dataMutex;                       // Process control
@@ -112,7 +145,27 @@ private:
     bool showCallingPointETD;                   // Flag to show Estimated Time of Departure in calling points
     bool selectPlatform;                        // Flag to indicate whether departures for a specific platform are selected
     std::string selected_platform;              // Store the selected platform
+    std::unique_ptr<ServiceFilter> service_filter;  // Compiled filter expression - null when no filter is set
+    std::vector<std::string> destination_filter;    // Destination CRS codes - empty when departures for all destinations are found
+    
+    std::string snapshot_path;                  // Board snapshot file - empty when snapshots aren't written
+    std::vector<char> snapshot_image;           // Snapshot encoding buffer - reused across updates
+    
+    // Calling-point index - CRS of each calling point to the indices of the services calling there
+    // Built in updateData so 'trains to X' is a single lookup for any number of destinations
+    std::unordered_map<std::string, std::vector<size_t>> calling_point_index;
+    std::vector<char> calls_at_destination;         // Scratch - per service, does it call at a filtered destination
     
+    // Replace the published board with a newly parsed one (swaps the arguments out)
+    void publishBoard(std::vector<TrainServiceInfo>& new_services,
+                      std::unordered_map<std::string, std::vector<size_t>>& new_calling_point_index,
+                      std::string& new_location_name,
+                      std::string& new_nrcc_message,
+                      size_t dropped);
+
+    // Make operator_name ("A <operator> service", for display) from operator_raw
+    static void setOperatorName(TrainServiceInfo& service);
+
     // Internal mechanics and datapoints
     std::array<size_t, 3> ServiceList;          // Array for the 1st, 2nd and 3rd departures
     std::array<size_t, 10> ETDOrderedList;      // Array of Service Indices in ETD order
@@ -121,6 +174,7 @@ private:
     std::atomic<uint64_t> data_version;
     
     size_t number_of_services;                  // Meta-data in the departure data
+    size_t dropped_services;                    // Services in the departure data missing a required field
     size_t first_service_index;
     size_t second_service_index;
     size_t third_service_index;
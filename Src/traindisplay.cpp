@@ -14,6 +14,7 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <memory>
 #include "config.h"
 #include "api_client.h"
 #include "train_service_parser.h"
@@ -22,6 +23,9 @@
 // Global debug flag
 bool debug_mode = false;
 
+// Run without the matrix (--headless)
+bool headless_mode = false;
+
 // Pointer to display for signal handling
 TrainServiceDisplay* display_ptr = nullptr;
 
@@ -33,12 +37,27 @@ void signalHandler(int signum) {
     }
 }
 
+// Signal handler for frame statistics (kill -USR2 <pid>)
+void frameStatsHandler(int) {
+    if (display_ptr) {
+        display_ptr->requestFrameStats();
+    }
+}
+
+// Signal handler to refresh the departures now (kill -USR1 <pid>)
+void refreshHandler(int) {
+    if (display_ptr) {
+        display_ptr->requestRefresh();
+    }
+}
+
 // Display usage information
 void showUsage(const char* programName) {
     std::cout << "Usage: " << programName << " [OPTIONS] [FROM_STATION] [TO_STATION] [REFRESH_INTERVAL]\n"
               << "Options:\n"
               << "  -d, --debug               Enable debug output\n"
               << "  -f, --config FILE         Specify configuration file\n"
+              << "      --headless            Run without the matrix, drawing into memory (see capture_path)\n"
               << "  -h, --help                Show this help message\n"
               << "\nExample:\n"
               << "  " << programName << " KGX YRK 60\n"
@@ -55,6 +74,8 @@ void processCommandLineArgs(int argc, char* argv[], Config& config) {
         std::string arg = argv[i];
         if (arg == "-d" || arg == "--debug") {
             debug_mode = true;
+        } else if (arg == "--headless") {
+            headless_mode = true;
         } else if (arg == "-h" || arg == "--help") {
             showUsage(argv[0]);
             exit(0);
@@ -125,18 +146,28 @@ void processCommandLineArgs(int argc, char* argv[], Config& config) {
     DEBUG_PRINT("From: " << config.get("from"));
     DEBUG_PRINT("To: " << config.get("to"));
     DEBUG_PRINT("Selected Platform: " << config.get("platform"));
+    DEBUG_PRINT("Filter: " << config.get("filter"));
+    DEBUG_PRINT("Local destination filter: " << config.getBool("local_destination_filter"));
     DEBUG_PRINT("Show Calling Point ETD: " << config.getBool("ShowCallingPointETD"));
     DEBUG_PRINT("Show Messages: " << config.getBool("ShowMessages"));
     DEBUG_PRINT("Show Platforms: " << config.getBool("ShowPlatforms"));
     DEBUG_PRINT("Show Location: " << config.getBool("ShowLocation"));
-    DEBUG_PRINT("Scroll slowdown (ms): " << config.get("scroll_slowdown_sleep_ms"));
+    DEBUG_PRINT("Frame rate (target): " << config.get("frame_rate") << ", frame queue depth: " << config.get("frame_queue_depth"));
+    DEBUG_PRINT("Scroll speeds (pixels/s): calling points " << config.get("calling_points_scroll_speed") << ", messages " << config.get("message_scroll_speed"));
     DEBUG_PRINT("API URL: " << config.get("APIURL"));
     DEBUG_PRINT("Use Raildata Marketplace (if yes/1 this will over-ride the API URL): " << config.getBool("Rail_Data_Marketplace"));
     DEBUG_PRINT("Font Path: " << config.get("fontPath"));
     DEBUG_PRINT("Data refresh interval (s): " << config.get("refresh_interval_seconds"));
+    DEBUG_PRINT("API timeout (s): " << config.get("api_timeout_seconds"));
     DEBUG_PRINT("Message display interval (s): " << config.get("Message_Refresh_interval"));
-    DEBUG_PRINT("2nd/3rd departure toggle interval (s): " << config.get("third_line_refresh_seconds"));
+    DEBUG_PRINT("2nd/3rd departure toggle interval (s): " << config.get("third_line_refresh_seconds") << ", roll-up speed (pixels/s): " << config.get("third_line_scroll_speed"));
     DEBUG_PRINT("Coach/ETD displayh interval (s): " << config.get("ETD_coach_refresh_seconds"));
+    DEBUG_PRINT("Thread scheduling (priority/CPUs): render " << config.get("render_thread_priority") << "/" << config.get("render_thread_cpus")
+                << ", refresh " << config.get("refresh_thread_priority") << "/" << config.get("refresh_thread_cpus")
+                << ", presenter " << config.get("presenter_thread_priority") << "/" << config.get("presenter_thread_cpus"));
+
+    DEBUG_PRINT("Board snapshot file: " << config.get("snapshot_path"));
+    DEBUG_PRINT("Headless: " << headless_mode << ". Frame capture: " << config.get("capture_path") << " (" << config.get("capture_format") << ", every " << config.get("capture_every") << " frames)");
 
     DEBUG_PRINT("Display Configuration: ");
     DEBUG_PRINT("Matrix columns: " << config.get("matrixcols"));
@@ -157,44 +188,78 @@ int main(int argc, char* argv[]) {
     // Set up signal handlers
     signal(SIGINT, signalHandler);
     signal(SIGTERM, signalHandler);
+    signal(SIGUSR1, refreshHandler);
+    signal(SIGUSR2, frameStatsHandler);
     
     try {
         // Initialize configuration
         Config config;
         processCommandLineArgs(argc, argv, config);
    
-        // Create matrix from config
-        RGBMatrix* matrix = config.createMatrix();
-        if (!matrix) {
-            std::cerr << "Failed to create RGB Matrix. Check your hardware configuration." << std::endl;
-            return 1;
+        // Create matrix from config - or an in-memory display the same size when headless
+        RGBMatrix* matrix = nullptr;
+        std::unique_ptr<DisplayBackend> backend;
+        if (headless_mode) {
+            HeadlessBackend* headless = new HeadlessBackend(config.getInt("matrixcols") * config.getInt("matrixchain_length"),
+                                                            config.getInt("matrixrows") * config.getInt("matrixparallel"));
+            headless->setCapture(config.get("capture_path"),
+                                 config.get("capture_format") == "bitplanes" ? HeadlessBackend::BITPLANES : HeadlessBackend::PPM,
+                                 config.getInt("capture_every"));
+            backend.reset(headless);
+        } else {
+            matrix = config.createMatrix();
+            if (!matrix) {
+                std::cerr << "Failed to create RGB Matrix. Check your hardware configuration." << std::endl;
+                return 1;
+            }
+            backend.reset(new MatrixBackend(matrix));
         }
         
         // Create API client
         TrainAPIClient apiClient(config.get("APIURL"), config.get("APIkey"), config.getBool("Rail_Data_Marketplace"));
+        apiClient.setTimeout(config.getInt("api_timeout_seconds"));
+        
+        // Set up the parser - each new board is saved to the snapshot file (if set)
+        TrainServiceParser parser;
+        parser.setSnapshotPath(config.get("snapshot_path"));
         
-        // Make initial API call and set up parser
+        // Make initial API call
         std::string api_data;
         try {
-            api_data = apiClient.fetchDepartures(config.get("from"), config.get("to"));
+            // If the destination is filtered locally then fetch departures for all destinations
+            api_data = apiClient.fetchDepartures(config.get("from"),
+                                                 config.getBool("local_destination_filter") ? "" : config.get("to"));
+            parser.updateData(api_data);
         } catch (const std::exception& e) {
             std::cerr << "Failed to fetch initial train data: " << e.what() << std::endl;
-            std::cerr << "Check internet connection and station codes." << std::endl;
-            delete matrix;
-            return 1;
+            
+            // Warm start from the last saved board - it's replaced on the next successful refresh
+            bool warm_start = false;
+            if (!config.get("snapshot_path").empty()) {
+                try {
+                    parser.loadSnapshot(config.get("snapshot_path"));
+                    warm_start = true;
+                    std::cerr << "Starting with the saved board from " << config.get("snapshot_path") << std::endl;
+                } catch (const std::exception& snapshot_error) {
+                    std::cerr << "Failed to load saved board: " << snapshot_error.what() << std::endl;
+                }
+            }
+            if (!warm_start) {
+                std::cerr << "Check internet connection and station codes." << std::endl;
+                delete matrix;
+                return 1;
+            }
         }
-        
-        TrainServiceParser parser;
-        parser.updateData(api_data);
         DEBUG_PRINT("API initialised"); 
         // Create and run the display
-        TrainServiceDisplay display(matrix, parser, apiClient, config);
+        TrainServiceDisplay display(*backend, parser, apiClient, config);
         display_ptr = &display; // Set global pointer for signal handler
         
         std::cout << "Train display running. Press Ctrl+C to exit." << std::endl;
         display.run();
         
         // Cleanup
+        backend.reset();
         delete matrix;
         
     } catch (const std::exception& e) {